@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DECIMATOR
+#define DECIMATOR
+
+#include <cmath>
+#include <cstdint>
+
+/**
+ * Decides per sample whether a message is to be published to reduce its
+ * output rate, either by passing every n-th packet or by passing the first
+ * sample in each period of sample time (e.g., GPS time). The latter keeps
+ * the output aligned to full periods independently of the input rate and of
+ * lost packets. A default-constructed Decimator passes every sample.
+ */
+class Decimator {
+   public:
+    enum class Mode : uint8_t {
+        PACKET_COUNT,
+        SAMPLE_TIME,
+    };
+
+   public:
+    Decimator() = default;
+
+    /**
+     * Constructor.
+     *
+     * @param rate Output rate in Hz; 0 suppresses the message entirely.
+     * @param mode Decimation on packet count or on sample time.
+     * @param inputRate Nominal packet rate in Hz for PACKET_COUNT.
+     */
+    Decimator(float rate, Mode mode, float inputRate) noexcept
+        : m_mode(mode)
+        , m_enabled(0.0f < rate) {
+        if (m_enabled) {
+            if (Mode::PACKET_COUNT == m_mode) {
+                const float EVERY{std::round(inputRate / rate)};
+                m_every = (1.0f < EVERY) ? static_cast<uint32_t>(EVERY) : 1;
+            } else {
+                m_period = static_cast<int64_t>(std::llround(1000000.0 / static_cast<double>(rate)));
+                m_period = (0 < m_period) ? m_period : 1;
+            }
+        }
+    }
+
+    /**
+     * @param sampleTime Sample time in microseconds.
+     * @return true if this sample is to be published.
+     */
+    bool pass(int64_t sampleTime) noexcept {
+        bool retVal{m_enabled};
+        if (retVal) {
+            if (Mode::PACKET_COUNT == m_mode) {
+                retVal = (0 == m_counter);
+                m_counter = (m_counter + 1) % m_every;
+            } else {
+                const int64_t SLOT{sampleTime / m_period};
+                retVal = (SLOT != m_lastSlot);
+                m_lastSlot = SLOT;
+            }
+        }
+        return retVal;
+    }
+
+   private:
+    Mode m_mode{Mode::PACKET_COUNT};
+    bool m_enabled{true};
+    uint32_t m_every{1};
+    uint32_t m_counter{0};
+    int64_t m_period{1};
+    int64_t m_lastSlot{-1};
+};
+
+#endif
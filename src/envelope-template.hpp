@@ -0,0 +1,433 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ENVELOPE_TEMPLATE
+#define ENVELOPE_TEMPLATE
+
+#include "cluon-complete.hpp"
+
+#include <endian.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <array>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Serialized OD4 envelope (including the 5-byte OD4 header) for one message
+ * type with scalar fields only or with one bytes field of fixed length. All variable-length integers are written with
+ * their maximum width, i.e., padded with continuation bytes, which Protobuf
+ * decoders accept. Hence, the layout does not depend on the values and each
+ * new sample is written in place into its fixed slots without any allocation.
+ */
+class EnvelopeTemplate {
+   private:
+    EnvelopeTemplate(const EnvelopeTemplate &) = delete;
+    EnvelopeTemplate(EnvelopeTemplate &&)      = delete;
+    EnvelopeTemplate &operator=(const EnvelopeTemplate &) = delete;
+    EnvelopeTemplate &operator=(EnvelopeTemplate &&) = delete;
+
+   private:
+    enum class Kind : uint8_t {
+        FIXED32,
+        FIXED64,
+        VARINT,
+        ZIGZAG,
+    };
+
+    // Location of one field in the message object and in the buffer.
+    class Slot {
+       public:
+        uint16_t bufferOffset{0};
+        uint16_t memberOffset{0};
+        uint8_t memberSize{0};
+        Kind kind{Kind::VARINT};
+    };
+
+    static constexpr uint8_t VARINT{0};
+    static constexpr uint8_t EIGHT_BYTES{1};
+    static constexpr uint8_t LENGTH_DELIMITED{2};
+    static constexpr uint8_t FOUR_BYTES{5};
+    static constexpr std::size_t VARINT32{5};
+    static constexpr std::size_t VARINT64{10};
+    // Nested cluon.data.TimeStamp: Two keys plus two padded varints.
+    static constexpr std::size_t TIMESTAMP{2 + 2 * VARINT32};
+
+   public:
+    /**
+     * Envelope meta data of one packet, encoded once and copied into the
+     * templates of all messages published for that packet.
+     */
+    class MetaData {
+       public:
+        /**
+         * Constructor.
+         *
+         * @param sent Time point of sending.
+         * @param sampleTimeStamp Time point of sampling; sent if zero.
+         * @param senderStamp Sender stamp.
+         */
+        MetaData(const cluon::data::TimeStamp &sent, const cluon::data::TimeStamp &sampleTimeStamp, uint32_t senderStamp) noexcept {
+            const bool NO_SAMPLE_TIME{0 == (sampleTimeStamp.seconds() + sampleTimeStamp.microseconds())};
+            const cluon::data::TimeStamp &sample{NO_SAMPLE_TIME ? sent : sampleTimeStamp};
+            putTimeStamp(m_sent.data(), sent.seconds(), sent.microseconds());
+            putTimeStamp(m_sampleTimeStamp.data(), sample.seconds(), sample.microseconds());
+            putPaddedVarInt(m_senderStamp.data(), senderStamp, VARINT32);
+        }
+
+       private:
+        friend class EnvelopeTemplate;
+        std::array<char, 1 + TIMESTAMP> m_sent{};
+        std::array<char, 1 + TIMESTAMP> m_sampleTimeStamp{};
+        std::array<char, VARINT32> m_senderStamp{};
+    };
+
+   private:
+    // Collects the slots of a message's fields while visiting it.
+    class LayoutVisitor {
+       private:
+        LayoutVisitor(const LayoutVisitor &) = delete;
+        LayoutVisitor(LayoutVisitor &&)      = delete;
+        LayoutVisitor &operator=(const LayoutVisitor &) = delete;
+        LayoutVisitor &operator=(LayoutVisitor &&) = delete;
+
+       public:
+        LayoutVisitor(const char *message, std::vector<Slot> &slots, std::vector<uint32_t> &ids) noexcept
+            : m_message(message)
+            , m_slots(slots)
+            , m_ids(ids) {}
+
+        void operator()(uint32_t, std::string &&, std::string &&, std::string &) noexcept {
+            m_isSupported = false;
+        }
+
+        template <typename V>
+        void operator()(uint32_t id, std::string &&, std::string &&, V &value) noexcept {
+            Slot s;
+            s.memberOffset = static_cast<uint16_t>(reinterpret_cast<const char *>(&value) - m_message);
+            s.memberSize = static_cast<uint8_t>(sizeof(V));
+            if (std::is_floating_point<V>::value) {
+                s.kind = (4 == sizeof(V)) ? Kind::FIXED32 : Kind::FIXED64;
+            } else if (std::is_integral<V>::value) {
+                s.kind = (std::is_signed<V>::value && !std::is_same<V, char>::value) ? Kind::ZIGZAG : Kind::VARINT;
+            } else {
+                m_isSupported = false;
+            }
+            m_slots.push_back(s);
+            m_ids.push_back(id);
+        }
+
+        bool isSupported() const noexcept {
+            return m_isSupported;
+        }
+
+       private:
+        const char *m_message;
+        std::vector<Slot> &m_slots;
+        std::vector<uint32_t> &m_ids;
+        bool m_isSupported{true};
+    };
+
+   public:
+    /**
+     * Constructor: Lays out the envelope for the given message's type.
+     *
+     * @param message Message defining the type; its values are not used.
+     */
+    template <typename T>
+    explicit EnvelopeTemplate(T message) noexcept
+        : m_dataType(T::ID()) {
+        static_assert(std::is_standard_layout<T>::value, "Member offsets require standard layout.");
+        std::vector<uint32_t> ids;
+        uint32_t numberOfMessages{0};
+        LayoutVisitor visitor(reinterpret_cast<const char *>(&message), m_slots, ids);
+        message.accept([&numberOfMessages](int32_t, const std::string &, const std::string &) { numberOfMessages++; },
+                       visitor,
+                       []() {});
+        // Nested messages would have been flattened by the visit.
+        m_isValid = visitor.isSupported() && (1 == numberOfMessages);
+        if (!m_isValid) {
+            return;
+        }
+
+        std::size_t payloadLength{0};
+        for (std::size_t i{0}; i < m_slots.size(); i++) {
+            payloadLength += lengthOfVarInt((ids[i] << 3) | wireTypeOf(m_slots[i].kind)) + widthOf(m_slots[i]);
+        }
+
+        char *p = beginEnvelope(payloadLength);
+        for (std::size_t i{0}; i < m_slots.size(); i++) {
+            p = putVarInt(p, (ids[i] << 3) | wireTypeOf(m_slots[i].kind));
+            m_slots[i].bufferOffset = static_cast<uint16_t>(p - m_buffer.data());
+            p += widthOf(m_slots[i]);
+        }
+        endEnvelope(p);
+    }
+
+    /**
+     * Constructor: Lays out the envelope for a message type consisting of a
+     * single bytes field with a fixed length, e.g., a raw packet.
+     *
+     * @param dataType Message identifier.
+     * @param fieldId Identifier of the bytes field.
+     * @param length Number of bytes per message.
+     */
+    EnvelopeTemplate(int32_t dataType, uint32_t fieldId, std::size_t length) noexcept
+        : m_dataType(dataType)
+        , m_isValid(true)
+        , m_bytesLength(length) {
+        const uint64_t KEY{(fieldId << 3) | LENGTH_DELIMITED};
+        char *p = beginEnvelope(lengthOfVarInt(KEY) + lengthOfVarInt(length) + length);
+        p = putVarInt(p, KEY);
+        p = putVarInt(p, length);
+        m_bytesOffset = static_cast<std::size_t>(p - m_buffer.data());
+        endEnvelope(p + length);
+    }
+    ~EnvelopeTemplate() = default;
+
+   public:
+    /**
+     * @return true if the message type is supported (scalar fields only).
+     */
+    bool isValid() const noexcept {
+        return m_isValid;
+    }
+
+    /**
+     * Write the given message and envelope meta data into the template.
+     *
+     * @param message Message of the type given to the constructor.
+     * @param sent Time point of sending.
+     * @param sampleTimeStamp Time point of sampling; sent if zero.
+     * @param senderStamp Sender stamp.
+     */
+    template <typename T>
+    void update(const T &message, const cluon::data::TimeStamp &sent, const cluon::data::TimeStamp &sampleTimeStamp, uint32_t senderStamp) noexcept {
+        update(message, MetaData(sent, sampleTimeStamp, senderStamp));
+    }
+
+    /**
+     * Write the given message and pre-encoded envelope meta data into the template.
+     *
+     * @param message Message of the type given to the constructor.
+     * @param metaData Meta data shared by all messages of one packet.
+     */
+    template <typename T>
+    void update(const T &message, const MetaData &metaData) noexcept {
+        if (!m_isValid || (T::ID() != m_dataType)) {
+            return;
+        }
+        const char *base = reinterpret_cast<const char *>(&message);
+        char *buffer = m_buffer.data();
+        for (const auto &s : m_slots) {
+            char *slot = buffer + s.bufferOffset;
+            const char *member = base + s.memberOffset;
+            switch (s.kind) {
+                case Kind::FIXED32: {
+                    uint32_t v{0};
+                    std::memcpy(&v, member, sizeof(v));
+                    v = htole32(v);
+                    std::memcpy(slot, &v, sizeof(v));
+                    break;
+                }
+                case Kind::FIXED64: {
+                    uint64_t v{0};
+                    std::memcpy(&v, member, sizeof(v));
+                    v = htole64(v);
+                    std::memcpy(slot, &v, sizeof(v));
+                    break;
+                }
+                case Kind::VARINT:
+                    putPaddedVarInt(slot, unsignedOf(member, s.memberSize), widthOf(s));
+                    break;
+                case Kind::ZIGZAG:
+                    putPaddedVarInt(slot, zigzag(signedOf(member, s.memberSize)), widthOf(s));
+                    break;
+            }
+        }
+
+        copyMetaData(metaData);
+    }
+
+    /**
+     * Write the given bytes and envelope meta data into a template for bytes.
+     *
+     * @param bytes Bytes of the length given to the constructor.
+     * @param sent Time point of sending.
+     * @param received Time point of receiving.
+     * @param sampleTimeStamp Time point of sampling; sent if zero.
+     * @param senderStamp Sender stamp.
+     */
+    void update(const char *bytes, const cluon::data::TimeStamp &sent, const cluon::data::TimeStamp &received, const cluon::data::TimeStamp &sampleTimeStamp, uint32_t senderStamp) noexcept {
+        if (!m_isValid || (0 == m_bytesOffset)) {
+            return;
+        }
+        char *buffer = m_buffer.data();
+        std::memcpy(buffer + m_bytesOffset, bytes, m_bytesLength);
+        putTimeStamp(buffer + m_receivedOffset, received.seconds(), received.microseconds());
+        copyMetaData(MetaData(sent, sampleTimeStamp, senderStamp));
+    }
+
+    /**
+     * @return Serialized envelope including the OD4 header.
+     */
+    const char *data() const noexcept {
+        return m_buffer.data();
+    }
+
+    std::size_t size() const noexcept {
+        return m_buffer.size();
+    }
+
+   private:
+    // Write OD4 header and envelope up to the payload of the given length.
+    char *beginEnvelope(std::size_t payloadLength) noexcept {
+        // Envelope: dataType, serializedData, sent, received, sampleTimeStamp, senderStamp.
+        const uint64_t DATA_TYPE{zigzag(m_dataType)};
+        const std::size_t ENVELOPE_LENGTH{1 + lengthOfVarInt(DATA_TYPE)
+            + 1 + lengthOfVarInt(payloadLength) + payloadLength
+            + 3 * (1 + 1 + TIMESTAMP)
+            + 1 + VARINT32};
+        m_buffer.resize(5 + ENVELOPE_LENGTH);
+
+        char *p = m_buffer.data();
+        *p++ = static_cast<char>(0x0D);
+        *p++ = static_cast<char>(0xA4);
+        *p++ = static_cast<char>(ENVELOPE_LENGTH & 0xFF);
+        *p++ = static_cast<char>((ENVELOPE_LENGTH >> 8) & 0xFF);
+        *p++ = static_cast<char>((ENVELOPE_LENGTH >> 16) & 0xFF);
+
+        p = putVarInt(p, (1 << 3) | VARINT);
+        p = putVarInt(p, DATA_TYPE);
+        p = putVarInt(p, (2 << 3) | LENGTH_DELIMITED);
+        return putVarInt(p, payloadLength);
+    }
+
+    // Write the envelope's time stamps and sender stamp after the payload.
+    void endEnvelope(char *p) noexcept {
+        p = putVarInt(p, (3 << 3) | LENGTH_DELIMITED);
+        m_sentOffset = static_cast<std::size_t>(p - m_buffer.data());
+        p = putTimeStamp(p, 0, 0);
+        p = putVarInt(p, (4 << 3) | LENGTH_DELIMITED);
+        m_receivedOffset = static_cast<std::size_t>(p - m_buffer.data());
+        p = putTimeStamp(p, 0, 0);
+        p = putVarInt(p, (5 << 3) | LENGTH_DELIMITED);
+        m_sampleTimeStampOffset = static_cast<std::size_t>(p - m_buffer.data());
+        p = putTimeStamp(p, 0, 0);
+        p = putVarInt(p, (6 << 3) | VARINT);
+        m_senderStampOffset = static_cast<std::size_t>(p - m_buffer.data());
+        putPaddedVarInt(p, 0, VARINT32);
+    }
+
+    void copyMetaData(const MetaData &metaData) noexcept {
+        char *buffer = m_buffer.data();
+        std::memcpy(buffer + m_sentOffset, metaData.m_sent.data(), metaData.m_sent.size());
+        std::memcpy(buffer + m_sampleTimeStampOffset, metaData.m_sampleTimeStamp.data(), metaData.m_sampleTimeStamp.size());
+        std::memcpy(buffer + m_senderStampOffset, metaData.m_senderStamp.data(), metaData.m_senderStamp.size());
+    }
+
+    static uint8_t wireTypeOf(Kind kind) noexcept {
+        return (Kind::FIXED32 == kind) ? FOUR_BYTES : ((Kind::FIXED64 == kind) ? EIGHT_BYTES : VARINT);
+    }
+
+    static std::size_t widthOf(const Slot &s) noexcept {
+        if (Kind::FIXED32 == s.kind) {
+            return 4;
+        }
+        if (Kind::FIXED64 == s.kind) {
+            return 8;
+        }
+        return (8 == s.memberSize) ? VARINT64 : VARINT32;
+    }
+
+    static uint64_t zigzag(int64_t v) noexcept {
+        return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+    }
+
+    static uint64_t unsignedOf(const char *member, uint8_t size) noexcept {
+        uint64_t v{0};
+        switch (size) {
+            case 1: { uint8_t x{0}; std::memcpy(&x, member, 1); v = x; break; }
+            case 2: { uint16_t x{0}; std::memcpy(&x, member, 2); v = x; break; }
+            case 4: { uint32_t x{0}; std::memcpy(&x, member, 4); v = x; break; }
+            default: std::memcpy(&v, member, 8); break;
+        }
+        return v;
+    }
+
+    static int64_t signedOf(const char *member, uint8_t size) noexcept {
+        int64_t v{0};
+        switch (size) {
+            case 1: { int8_t x{0}; std::memcpy(&x, member, 1); v = x; break; }
+            case 2: { int16_t x{0}; std::memcpy(&x, member, 2); v = x; break; }
+            case 4: { int32_t x{0}; std::memcpy(&x, member, 4); v = x; break; }
+            default: std::memcpy(&v, member, 8); break;
+        }
+        return v;
+    }
+
+    static std::size_t lengthOfVarInt(uint64_t v) noexcept {
+        std::size_t length{1};
+        for (; 0x7F < v; v >>= 7) {
+            length++;
+        }
+        return length;
+    }
+
+    static char *putVarInt(char *p, uint64_t v) noexcept {
+        for (; 0x7F < v; v >>= 7) {
+            *p++ = static_cast<char>((v & 0x7F) | 0x80);
+        }
+        *p++ = static_cast<char>(v);
+        return p;
+    }
+
+    // Write v using exactly width bytes.
+    static char *putPaddedVarInt(char *p, uint64_t v, std::size_t width) noexcept {
+        for (std::size_t i{1}; i < width; i++) {
+            *p++ = static_cast<char>((v & 0x7F) | 0x80);
+            v >>= 7;
+        }
+        *p++ = static_cast<char>(v & 0x7F);
+        return p;
+    }
+
+    static char *putTimeStamp(char *p, int32_t seconds, int32_t microseconds) noexcept {
+        *p++ = static_cast<char>(TIMESTAMP);
+        *p++ = static_cast<char>((1 << 3) | VARINT);
+        p = putPaddedVarInt(p, zigzag(seconds), VARINT32);
+        *p++ = static_cast<char>((2 << 3) | VARINT);
+        return putPaddedVarInt(p, zigzag(microseconds), VARINT32);
+    }
+
+   private:
+    int32_t m_dataType{0};
+    bool m_isValid{false};
+    std::vector<Slot> m_slots{};
+    std::vector<char> m_buffer{};
+    std::size_t m_sentOffset{0};
+    std::size_t m_receivedOffset{0};
+    std::size_t m_sampleTimeStampOffset{0};
+    std::size_t m_senderStampOffset{0};
+    std::size_t m_bytesOffset{0};
+    std::size_t m_bytesLength{0};
+};
+
+#endif
@@ -0,0 +1,392 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "nav-state-publisher.hpp"
+#include "split.hpp"
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <utility>
+
+namespace {
+const constexpr std::size_t RAW_PACKET_LENGTH{72};
+const constexpr uint32_t MAX_REQUESTS{64};
+}
+
+NavStatePublisher::NavStatePublisher(uint16_t cid, Messages messages, bool attitude) noexcept
+    : m_acceleration(opendlv::proxy::AccelerationReading())
+    , m_angularVelocity(opendlv::proxy::AngularVelocityReading())
+    , m_position(opendlv::proxy::GeodeticWgs84Reading())
+    , m_heading(opendlv::proxy::GeodeticHeadingReading())
+    , m_speed(opendlv::proxy::GroundSpeedReading())
+    , m_altitude(opendlv::proxy::AltitudeReading())
+    , m_geolocation(opendlv::logic::sensation::Geolocation())
+    , m_navState(opendlv::device::gps::ncom::NavState())
+    , m_equilibrioception(opendlv::logic::sensation::Equilibrioception())
+    , m_attitudeMessage(opendlv::device::gps::ncom::Attitude())
+    , m_rawPacket(opendlv::device::gps::ncom::RawPacket::ID(), 1, RAW_PACKET_LENGTH)
+    , m_statusMessage(opendlv::device::gps::ncom::Status())
+    , m_requests(MAX_REQUESTS, OverflowPolicy::DROP_NEWEST) {
+    // Message types that are not selected are decimated away entirely.
+    const Decimator OFF{0.0f, Decimator::Mode::PACKET_COUNT, 0.0f};
+    if (Messages::STANDARD == messages) {
+        m_configured[NAV_STATE_MESSAGE] = OFF;
+    }
+    if (Messages::COMPOUND == messages) {
+        for (auto index : {ACCELERATION, ANGULAR_VELOCITY, POSITION, HEADING, SPEED, ALTITUDE, GEOLOCATION}) {
+            m_configured[index] = OFF;
+        }
+    }
+    if (!attitude) {
+        m_configured[EQUILIBRIOCEPTION] = OFF;
+        m_configured[ATTITUDE] = OFF;
+    }
+    m_configured[STATUS] = OFF;
+    m_decimators = m_configured;
+
+    // Same group and port as cluon::OD4Session.
+    const std::string GROUP{"225.0.0." + std::to_string(cid)};
+    m_address.sin_family = AF_INET;
+    m_address.sin_port = htons(12175);
+    if ( (0 == cid) || (255 < cid) || (1 != ::inet_pton(AF_INET, GROUP.c_str(), &m_address.sin_addr)) ) {
+        std::cerr << "[NavStatePublisher] Invalid CID " << cid << std::endl;
+        return;
+    }
+
+    m_socket = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, IPPROTO_UDP);
+    if (0 > m_socket) {
+        std::cerr << "[NavStatePublisher] Error while creating socket: " << errno << std::endl;
+    }
+}
+
+NavStatePublisher::~NavStatePublisher() noexcept {
+    if (0 <= m_socket) {
+        ::close(m_socket);
+    }
+}
+
+bool NavStatePublisher::isValid() const noexcept {
+    return (0 <= m_socket) && m_acceleration.isValid() && m_angularVelocity.isValid() && m_position.isValid() && m_heading.isValid()
+           && m_speed.isValid() && m_altitude.isValid() && m_geolocation.isValid() && m_navState.isValid()
+           && m_equilibrioception.isValid() && m_attitudeMessage.isValid()
+           && m_statusMessage.isValid();
+}
+
+bool NavStatePublisher::indexOf(const std::string &name, Index &index) noexcept {
+    const std::array<std::pair<std::string, Index>, NUMBER_OF_MESSAGES> NAMES{{
+        {opendlv::proxy::AccelerationReading::ShortName(), ACCELERATION},
+        {opendlv::proxy::AngularVelocityReading::ShortName(), ANGULAR_VELOCITY},
+        {opendlv::proxy::GeodeticWgs84Reading::ShortName(), POSITION},
+        {opendlv::proxy::GeodeticHeadingReading::ShortName(), HEADING},
+        {opendlv::proxy::GroundSpeedReading::ShortName(), SPEED},
+        {opendlv::proxy::AltitudeReading::ShortName(), ALTITUDE},
+        {opendlv::logic::sensation::Geolocation::ShortName(), GEOLOCATION},
+        {opendlv::device::gps::ncom::NavState::ShortName(), NAV_STATE_MESSAGE},
+        {opendlv::logic::sensation::Equilibrioception::ShortName(), EQUILIBRIOCEPTION},
+        {opendlv::device::gps::ncom::Attitude::ShortName(), ATTITUDE},
+        {opendlv::device::gps::ncom::Status::ShortName(), STATUS},
+    }};
+    for (const auto &entry : NAMES) {
+        if (entry.first == name) {
+            index = entry.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool NavStatePublisher::setRates(const std::string &rates, Decimator::Mode mode, float inputRate, bool exclusive) noexcept {
+    if (exclusive) {
+        m_configured.fill(Decimator(0.0f, mode, inputRate));
+    }
+
+    bool retVal{true};
+    try {
+        for (auto entry : split(rates, ',')) {
+            entry = stringtoolbox::trim(entry);
+            const std::string::size_type COLON{entry.find(':')};
+            Index index{NUMBER_OF_MESSAGES};
+            // A rate must be a positive number without trailing characters;
+            // 0 is only requested through subscriptions to unsubscribe.
+            float rate{0.0f};
+            std::size_t parsed{0};
+            if (std::string::npos != COLON) {
+                const std::string RATE{entry.substr(COLON + 1)};
+                rate = std::stof(RATE, &parsed);
+                parsed = (RATE.size() == parsed) ? parsed : 0;
+            }
+            if ( indexOf(entry.substr(0, COLON), index)
+                 && ((std::string::npos == COLON) || ((0 < parsed) && std::isfinite(rate) && (0.0f < rate))) ) {
+                m_configured[index] = (std::string::npos != COLON) ? Decimator(rate, mode, inputRate) : Decimator();
+            } else {
+                std::cerr << "[NavStatePublisher] Unknown or malformed rate '" << entry << "', expected name:Hz." << std::endl;
+                retVal = false;
+            }
+        }
+    } catch (...) {
+        std::cerr << "[NavStatePublisher] Malformed list of rates '" << rates << "'." << std::endl;
+        retVal = false;
+    }
+    m_mode = mode;
+    m_inputRate = inputRate;
+    m_decimators = m_configured;
+    m_units.clear();
+    return retVal;
+}
+
+void NavStatePublisher::enableStatus(const StatusFilter::Deadbands &deadbands, std::chrono::microseconds heartbeat) noexcept {
+    m_configured[STATUS] = Decimator();
+    m_statusFilter = StatusFilter(deadbands, heartbeat.count());
+    m_decimators = m_configured;
+    m_units.clear();
+}
+
+void NavStatePublisher::enableSubscriptions(bool onDemand, Decimator::Mode mode, float inputRate, std::chrono::milliseconds lease) noexcept {
+    if (onDemand) {
+        m_configured.fill(Decimator(0.0f, mode, inputRate));
+    }
+    m_mode = mode;
+    m_inputRate = inputRate;
+    m_lease = lease;
+    m_decimators = m_configured;
+    m_units.clear();
+}
+
+bool NavStatePublisher::subscribe(uint32_t requester, const std::string &name, float rate) noexcept {
+    Index index{NUMBER_OF_MESSAGES};
+    if (!indexOf(name, index)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lck(m_subscriptionsMutex);
+    // A rate of exactly 0 (or NaN) ends the subscription.
+    const bool UNSUBSCRIBE{!(0.0f < rate) && !(0.0f > rate)};
+    const std::chrono::steady_clock::time_point NOW{std::chrono::steady_clock::now()};
+    auto it = std::find_if(m_subscriptions.begin(), m_subscriptions.end(), [requester, index](const Subscription &s) {
+        return (requester == s.requester) && (index == s.index);
+    });
+    if (m_subscriptions.end() != it) {
+        const Subscription PREVIOUS{*it};
+        const std::size_t OFFSET{static_cast<std::size_t>(it - m_subscriptions.begin())};
+        if (UNSUBSCRIBE) {
+            m_subscriptions.erase(it);
+        } else {
+            it->rate = rate;
+            it->renewed = NOW;
+        }
+        if (!request(index)) {
+            // Keep the subscriptions consistent with what is published.
+            if (UNSUBSCRIBE) {
+                m_subscriptions.insert(m_subscriptions.begin() + static_cast<std::ptrdiff_t>(OFFSET), PREVIOUS);
+            } else {
+                m_subscriptions[OFFSET] = PREVIOUS;
+            }
+            return false;
+        }
+        return true;
+    }
+    if (UNSUBSCRIBE) {
+        return request(index);
+    }
+    try {
+        m_subscriptions.push_back(Subscription{requester, index, rate, NOW});
+    } catch (...) {
+        return false;
+    }
+    if (!request(index)) {
+        m_subscriptions.pop_back();
+        return false;
+    }
+    return true;
+}
+
+uint32_t NavStatePublisher::expireSubscriptions() noexcept {
+    uint32_t retVal{0};
+    if (0 < m_lease.count()) {
+        std::lock_guard<std::mutex> lck(m_subscriptionsMutex);
+        const std::chrono::steady_clock::time_point NOW{std::chrono::steady_clock::now()};
+        for (std::size_t i{0}; i < m_subscriptions.size();) {
+            if (NOW - m_subscriptions[i].renewed < m_lease) {
+                i++;
+                continue;
+            }
+            const Subscription EXPIRED{m_subscriptions[i]};
+            m_subscriptions.erase(m_subscriptions.begin() + static_cast<std::ptrdiff_t>(i));
+            if (!request(EXPIRED.index)) {
+                // Try again next time.
+                m_subscriptions.insert(m_subscriptions.begin() + static_cast<std::ptrdiff_t>(i), EXPIRED);
+                break;
+            }
+            retVal++;
+        }
+    }
+    return retVal;
+}
+
+bool NavStatePublisher::request(Index index) noexcept {
+    // The highest rate of all requesters wins; without any, the configured one.
+    Request r;
+    r.index = index;
+    r.decimator = m_configured[index];
+    float highest{0.0f};
+    bool subscribed{false};
+    bool everySample{false};
+    for (const auto &subscription : m_subscriptions) {
+        if (index == subscription.index) {
+            subscribed = true;
+            everySample = everySample || (0.0f > subscription.rate);
+            highest = std::max(highest, subscription.rate);
+        }
+    }
+    if (subscribed) {
+        r.decimator = everySample ? Decimator() : Decimator(highest, m_mode, m_inputRate);
+    }
+    return m_requests.push(r);
+}
+
+void NavStatePublisher::applyRequests() noexcept {
+    Request request;
+    while (m_requests.pop(request)) {
+        m_decimators[request.index] = request.decimator;
+        for (auto &unit : m_units) {
+            unit.decimators[request.index] = request.decimator;
+        }
+    }
+}
+
+NavStatePublisher::UnitState &NavStatePublisher::stateOf(uint32_t senderStamp) noexcept {
+    for (auto &unit : m_units) {
+        if (senderStamp == unit.senderStamp) {
+            return unit;
+        }
+    }
+    // First packet of this unit.
+    UnitState unit;
+    unit.senderStamp = senderStamp;
+    unit.decimators = m_decimators;
+    unit.statusFilter = m_statusFilter;
+    m_units.push_back(unit);
+    return m_units.back();
+}
+
+void NavStatePublisher::enqueue(const EnvelopeTemplate &envelope) noexcept {
+    m_iovecs[m_pending].iov_base = const_cast<char *>(envelope.data());
+    m_iovecs[m_pending].iov_len = envelope.size();
+    m_headers[m_pending].msg_hdr.msg_name = &m_address;
+    m_headers[m_pending].msg_hdr.msg_namelen = sizeof(m_address);
+    m_headers[m_pending].msg_hdr.msg_iov = &m_iovecs[m_pending];
+    m_headers[m_pending].msg_hdr.msg_iovlen = 1;
+    m_pending++;
+}
+
+void NavStatePublisher::flush() noexcept {
+    // sendmmsg may send fewer datagrams than given, e.g., when interrupted.
+    uint32_t sent{0};
+    while (sent < m_pending) {
+        const int32_t RETVAL{::sendmmsg(m_socket, &m_headers[sent], m_pending - sent, 0)};
+        if (0 > RETVAL) {
+            if (EINTR == errno) {
+                continue;
+            }
+            break;
+        }
+        sent += static_cast<uint32_t>(RETVAL);
+    }
+    m_pending = 0;
+}
+
+void NavStatePublisher::publish(const NavState &state) noexcept {
+    const cluon::data::TimeStamp SENT{cluon::time::now()};
+    const cluon::data::TimeStamp &sampleTime{state.sampleTime};
+    const uint32_t SENDER_STAMP{state.senderStamp};
+    const NCOMDecoder::NCOMMessages &m{state.messages};
+    const int64_t SAMPLE_TIME{cluon::time::toMicroseconds(sampleTime)};
+    // Time stamps and sender stamp are encoded once for all envelopes.
+    const EnvelopeTemplate::MetaData META{SENT, sampleTime, SENDER_STAMP};
+    applyRequests();
+    UnitState &unit{stateOf(SENDER_STAMP)};
+    Decimators &d{unit.decimators};
+
+    // Message types that are neither selected nor subscribed never pass.
+    if (d[NAV_STATE_MESSAGE].pass(SAMPLE_TIME)) {
+        m_navState.update(state.compound(), META);
+        enqueue(m_navState);
+    }
+    if (d[ACCELERATION].pass(SAMPLE_TIME)) {
+        m_acceleration.update(m.acceleration, META);
+        enqueue(m_acceleration);
+    }
+    if (d[ANGULAR_VELOCITY].pass(SAMPLE_TIME)) {
+        m_angularVelocity.update(m.angularVelocity, META);
+        enqueue(m_angularVelocity);
+    }
+    if (d[POSITION].pass(SAMPLE_TIME)) {
+        m_position.update(m.position, META);
+        enqueue(m_position);
+    }
+    if (d[HEADING].pass(SAMPLE_TIME)) {
+        m_heading.update(m.heading, META);
+        enqueue(m_heading);
+    }
+    if (d[SPEED].pass(SAMPLE_TIME)) {
+        m_speed.update(m.speed, META);
+        enqueue(m_speed);
+    }
+    if (d[ALTITUDE].pass(SAMPLE_TIME)) {
+        m_altitude.update(m.altitude, META);
+        enqueue(m_altitude);
+    }
+    if (d[GEOLOCATION].pass(SAMPLE_TIME)) {
+        m_geolocation.update(m.geolocation, META);
+        enqueue(m_geolocation);
+    }
+
+    if (d[EQUILIBRIOCEPTION].pass(SAMPLE_TIME)) {
+        m_equilibrioception.update(m.equilibrioception, META);
+        enqueue(m_equilibrioception);
+    }
+    if (d[ATTITUDE].pass(SAMPLE_TIME)) {
+        m_attitudeMessage.update(state.attitude(), META);
+        enqueue(m_attitudeMessage);
+    }
+
+    // A rate for Status limits how often changes are published.
+    if ( d[STATUS].pass(SAMPLE_TIME) && unit.statusFilter.pass(m.status, SAMPLE_TIME) ) {
+        m_statusMessage.update(m.status, META);
+        enqueue(m_statusMessage);
+    }
+
+    // All envelopes of this packet go out with one system call.
+    if (0 < m_pending) {
+        flush();
+    }
+}
+
+void NavStatePublisher::publishRaw(const char *data, std::size_t length, const cluon::data::TimeStamp &received, uint32_t senderStamp) noexcept {
+    if ( (nullptr != data) && (RAW_PACKET_LENGTH == length) ) {
+        m_rawPacket.update(data, cluon::time::now(), received, received, senderStamp);
+        enqueue(m_rawPacket);
+        flush();
+    }
+}
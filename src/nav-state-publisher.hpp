@@ -0,0 +1,254 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NAV_STATE_PUBLISHER
+#define NAV_STATE_PUBLISHER
+
+#include "decimator.hpp"
+#include "envelope-template.hpp"
+#include "status-filter.hpp"
+#include "nav-state.hpp"
+#include "spsc-ring.hpp"
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Publishes the messages of a NavState to an OD4 session, either as the seven
+ * messages from the OpenDLV Standard Message Set, as one compound
+ * opendlv.device.gps.ncom.NavState message, or both; optionally together
+ * with Equilibrioception and opendlv.device.gps.ncom.Attitude, and with
+ * opendlv.device.gps.ncom.Status when it changed. Each message is
+ * written into its pre-serialized envelope and all envelopes of one packet
+ * are sent with a single sendmmsg() to the session's multicast group,
+ * without allocating memory. The output rate of each message type can be
+ * reduced; skipped messages are not serialized at all. At runtime, consumers
+ * can subscribe to message types at their own rates for a lease that they
+ * renew by repeating their request; such requests are handed over to the
+ * publishing thread through a lock-free ring and applied before the next
+ * packet.
+ * Not thread-safe: publish() must only be called from one thread at a time;
+ * subscribe() and expireSubscriptions() may be called from other threads.
+ */
+class NavStatePublisher {
+   private:
+    NavStatePublisher(const NavStatePublisher &) = delete;
+    NavStatePublisher(NavStatePublisher &&)      = delete;
+    NavStatePublisher &operator=(const NavStatePublisher &) = delete;
+    NavStatePublisher &operator=(NavStatePublisher &&) = delete;
+
+   public:
+    enum class Messages : uint8_t {
+        STANDARD,
+        COMPOUND,
+        BOTH,
+    };
+
+   public:
+    /**
+     * Constructor.
+     *
+     * @param cid OD4 session to publish to.
+     * @param messages Messages to publish per NCOM packet.
+     * @param attitude Also publish Equilibrioception and Attitude.
+     */
+    explicit NavStatePublisher(uint16_t cid, Messages messages = Messages::STANDARD, bool attitude = false) noexcept;
+    ~NavStatePublisher() noexcept;
+
+    /**
+     * @return true if the socket could be created.
+     */
+    bool isValid() const noexcept;
+
+    /**
+     * Set the output rates of message types. Unlisted message types keep
+     * their selection and are published for every packet unless exclusive.
+     *
+     * @param rates List of name:Hz entries separated by comma, where name is
+     *              the short name of a message (e.g., Geolocation:20) and
+     *              Hz a positive number; a name without rate is published
+     *              for every sample.
+     * @param mode Decimation on packet count or on sample time.
+     * @param inputRate Nominal NCOM packet rate in Hz for packet count.
+     * @param exclusive If true, only the listed message types are published.
+     * @return true if all entries could be parsed.
+     */
+    bool setRates(const std::string &rates, Decimator::Mode mode, float inputRate, bool exclusive = false) noexcept;
+
+    /**
+     * Publish opendlv.device.gps.ncom.Status whenever it changes beyond the
+     * given deadbands or at least once per heartbeat interval.
+     *
+     * @param deadbands Changes of accuracies to ignore.
+     * @param heartbeat Interval of sample time to publish unchanged status.
+     */
+    void enableStatus(const StatusFilter::Deadbands &deadbands, std::chrono::microseconds heartbeat) noexcept;
+
+    /**
+     * Configure how subscribed rates are decimated; must be called before
+     * publishing starts.
+     *
+     * @param onDemand If true, no message type is published until it is subscribed.
+     * @param mode Decimation on packet count or on sample time.
+     * @param inputRate Nominal NCOM packet rate in Hz for packet count.
+     * @param lease Time after which a subscription that was not renewed
+     *              expires; 0 for subscriptions that never expire.
+     */
+    void enableSubscriptions(bool onDemand, Decimator::Mode mode, float inputRate, std::chrono::milliseconds lease = std::chrono::milliseconds{0}) noexcept;
+
+    /**
+     * Subscribe to, renew, or unsubscribe from a message type at runtime.
+     * Each message type is published at the highest rate requested by any
+     * requester; once all requesters have unsubscribed or their leases have
+     * expired, the message type falls back to its configured rate (or none
+     * if on demand).
+     *
+     * @param requester Identifier of the requester, e.g., the sender stamp of
+     *                  its envelopes, which must hence be unique per consumer.
+     * @param name Short name of the message (e.g., Geolocation).
+     * @param rate Rate in Hz; negative for every sample, 0 to unsubscribe.
+     * @return true if the message type is known and the request was queued;
+     *         otherwise, the subscriptions are unchanged.
+     */
+    bool subscribe(uint32_t requester, const std::string &name, float rate) noexcept;
+
+    /**
+     * End all subscriptions that were not renewed within their lease; to be
+     * called periodically.
+     *
+     * @return Number of subscriptions ended.
+     */
+    uint32_t expireSubscriptions() noexcept;
+
+    /**
+     * Publish the messages decoded from one NCOM packet.
+     *
+     * @param state Navigation state to publish.
+     */
+    void publish(const NavState &state) noexcept;
+
+    /**
+     * Publish an undecoded NCOM packet as opendlv.device.gps.ncom.RawPacket;
+     * packets of other lengths than 72 bytes are ignored.
+     *
+     * @param data Packet.
+     * @param length Length of the packet.
+     * @param received Time point of reception, also used as sample time.
+     * @param senderStamp Sender stamp of the unit.
+     */
+    void publishRaw(const char *data, std::size_t length, const cluon::data::TimeStamp &received, uint32_t senderStamp) noexcept;
+
+   private:
+    // Index of each message type for its decimators.
+    enum Index : uint8_t {
+        ACCELERATION,
+        ANGULAR_VELOCITY,
+        POSITION,
+        HEADING,
+        SPEED,
+        ALTITUDE,
+        GEOLOCATION,
+        NAV_STATE_MESSAGE,
+        EQUILIBRIOCEPTION,
+        ATTITUDE,
+        STATUS,
+        NUMBER_OF_MESSAGES,
+    };
+    using Decimators = std::array<Decimator, NUMBER_OF_MESSAGES>;
+
+    // New decimator for a message type, computed by subscribe().
+    class Request {
+       public:
+        Index index{NUMBER_OF_MESSAGES};
+        Decimator decimator{};
+    };
+
+    // Rate requested by one requester for one message type.
+    class Subscription {
+       public:
+        uint32_t requester{0};
+        Index index{NUMBER_OF_MESSAGES};
+        float rate{0.0f};
+        std::chrono::steady_clock::time_point renewed{};
+    };
+
+    // Every unit is decimated and filtered independently.
+    class UnitState {
+       public:
+        uint32_t senderStamp{0};
+        Decimators decimators{};
+        StatusFilter statusFilter{};
+    };
+
+   private:
+    static bool indexOf(const std::string &name, Index &index) noexcept;
+    bool request(Index index) noexcept;
+    void applyRequests() noexcept;
+    UnitState &stateOf(uint32_t senderStamp) noexcept;
+    void enqueue(const EnvelopeTemplate &envelope) noexcept;
+    void flush() noexcept;
+
+   private:
+    int32_t m_socket{-1};
+    struct sockaddr_in m_address{};
+
+    EnvelopeTemplate m_acceleration;
+    EnvelopeTemplate m_angularVelocity;
+    EnvelopeTemplate m_position;
+    EnvelopeTemplate m_heading;
+    EnvelopeTemplate m_speed;
+    EnvelopeTemplate m_altitude;
+    EnvelopeTemplate m_geolocation;
+    EnvelopeTemplate m_navState;
+    EnvelopeTemplate m_equilibrioception;
+    EnvelopeTemplate m_attitudeMessage;
+    EnvelopeTemplate m_rawPacket;
+    EnvelopeTemplate m_statusMessage;
+
+    // One datagram per envelope, sent together per packet.
+    static constexpr std::size_t MAX_ENVELOPES{NUMBER_OF_MESSAGES};
+    std::array<struct iovec, MAX_ENVELOPES> m_iovecs{};
+    std::array<struct mmsghdr, MAX_ENVELOPES> m_headers{};
+    uint32_t m_pending{0};
+
+    // Configured decimators, only changed before publishing starts.
+    Decimators m_configured{};
+    Decimator::Mode m_mode{Decimator::Mode::SAMPLE_TIME};
+    float m_inputRate{100.0f};
+
+    // Decimators for new units including all applied requests.
+    Decimators m_decimators{};
+    StatusFilter m_statusFilter{};
+    std::vector<UnitState> m_units{};
+
+    // Owned by the subscribing threads; the mutex keeps them a single producer.
+    std::mutex m_subscriptionsMutex{};
+    std::chrono::milliseconds m_lease{0};
+    std::vector<Subscription> m_subscriptions{};
+    SPSCRing<Request> m_requests;
+};
+
+#endif
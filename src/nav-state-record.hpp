@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NAV_STATE_RECORD
+#define NAV_STATE_RECORD
+
+#include <cstdint>
+#include <type_traits>
+
+/**
+ * Compact binary navigation state of one NCOM packet for consumers on the
+ * same host, e.g., via NavStateServer. Values are in host byte order with
+ * the units of opendlv.device.gps.ncom.NavState; time stamps are in
+ * microseconds since the epoch. The layout is fixed and versioned so that
+ * consumers can use this header without any other dependency.
+ */
+class NavStateRecord {
+   public:
+    // Enumerator rather than static member, so it needs no definition.
+    enum : uint32_t { VERSION = 1 };
+
+   public:
+    uint32_t version{static_cast<uint32_t>(VERSION)};
+    uint32_t senderStamp{0};
+    // Sample time (GPS time unless --nogpstime) and host time of reception.
+    int64_t sampleTime{0};
+    int64_t received{0};
+    double latitude{0.0};
+    double longitude{0.0};
+    float altitude{0.0f};
+    float heading{0.0f};
+    float pitch{0.0f};
+    float roll{0.0f};
+    float velocityNorth{0.0f};
+    float velocityEast{0.0f};
+    float velocityDown{0.0f};
+    float groundSpeed{0.0f};
+    float accelerationX{0.0f};
+    float accelerationY{0.0f};
+    float accelerationZ{0.0f};
+    float angularVelocityX{0.0f};
+    float angularVelocityY{0.0f};
+    float angularVelocityZ{0.0f};
+};
+
+static_assert(std::is_trivially_copyable<NavStateRecord>::value, "NavStateRecord is copied as bytes.");
+static_assert(std::is_standard_layout<NavStateRecord>::value, "NavStateRecord has a fixed layout.");
+static_assert(96 == sizeof(NavStateRecord), "NavStateRecord must not contain padding.");
+
+#endif
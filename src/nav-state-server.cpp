@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "nav-state-server.hpp"
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+constexpr std::size_t NavStateServer::BATCH;
+
+NavStateServer::NavStateServer(const std::string &path) noexcept
+    : m_path(path) {
+    struct sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (m_path.empty() || (sizeof(address.sun_path) <= m_path.size())) {
+        std::cerr << "[NavStateServer] Invalid socket path '" << m_path << "'." << std::endl;
+        return;
+    }
+    std::memcpy(address.sun_path, m_path.c_str(), m_path.size());
+    socklen_t length{static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) + m_path.size() + 1)};
+    if ('@' == m_path[0]) {
+        // Abstract namespace: Nothing to clean up in the file system.
+        address.sun_path[0] = '\0';
+        length = static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) + m_path.size());
+    } else {
+        // Remove a stale socket from a previous run, but nothing else.
+        struct stat info{};
+        if ( (0 == ::stat(m_path.c_str(), &info)) && S_ISSOCK(info.st_mode) ) {
+            ::unlink(m_path.c_str());
+        }
+    }
+
+    m_socket = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (0 > m_socket) {
+        std::cerr << "[NavStateServer] Error while creating socket: " << errno << std::endl;
+        return;
+    }
+    if ( (0 != ::bind(m_socket, reinterpret_cast<struct sockaddr *>(&address), length)) || (0 != ::listen(m_socket, 16)) ) {
+        std::cerr << "[NavStateServer] Error while binding to '" << m_path << "': " << errno << std::endl;
+        ::close(m_socket);
+        m_socket = -1;
+        return;
+    }
+
+    m_running.store(true);
+    try {
+        m_acceptor = std::thread(&NavStateServer::accept, this);
+    } catch (...) {
+        m_running.store(false);
+    }
+}
+
+NavStateServer::~NavStateServer() noexcept {
+    m_running.store(false);
+    if (0 <= m_socket) {
+        // Wakes up the acceptor thread blocked in accept().
+        ::shutdown(m_socket, SHUT_RDWR);
+    }
+    if (m_acceptor.joinable()) {
+        m_acceptor.join();
+    }
+    for (auto fd : m_subscribers) {
+        ::close(fd);
+    }
+    for (auto fd : m_accepted) {
+        ::close(fd);
+    }
+    if (0 <= m_socket) {
+        ::close(m_socket);
+        if ('@' != m_path[0]) {
+            ::unlink(m_path.c_str());
+        }
+    }
+}
+
+bool NavStateServer::isValid() const noexcept {
+    return (0 <= m_socket) && m_running.load();
+}
+
+void NavStateServer::accept() noexcept {
+    while (m_running.load()) {
+        const int32_t FD{::accept4(m_socket, nullptr, nullptr, SOCK_CLOEXEC)};
+        if (0 > FD) {
+            if ( (EINTR == errno) || (ECONNABORTED == errno) ) {
+                continue;
+            }
+            break;
+        }
+        // Subscribers only read; shutting down the receive side keeps
+        // anything they send from piling up.
+        ::shutdown(FD, SHUT_RD);
+        try {
+            std::lock_guard<std::mutex> lck(m_acceptedMutex);
+            m_accepted.push_back(FD);
+            m_hasAccepted.store(true, std::memory_order_release);
+        } catch (...) {
+            ::close(FD);
+        }
+    }
+}
+
+void NavStateServer::add(const NavStateRecord &record) noexcept {
+    m_batch[m_pending++] = record;
+    if (BATCH == m_pending) {
+        flush();
+    }
+}
+
+void NavStateServer::flush() noexcept {
+    // Pick up new subscribers; the lock is only taken when there are any.
+    if (m_hasAccepted.load(std::memory_order_acquire)) {
+        try {
+            std::lock_guard<std::mutex> lck(m_acceptedMutex);
+            m_subscribers.insert(m_subscribers.end(), m_accepted.begin(), m_accepted.end());
+            m_accepted.clear();
+            m_hasAccepted.store(false, std::memory_order_relaxed);
+        } catch (...) {} // LCOV_EXCL_LINE
+    }
+
+    if (0 < m_pending) {
+        const std::size_t LENGTH{m_pending * sizeof(NavStateRecord)};
+        for (auto it = m_subscribers.begin(); it != m_subscribers.end();) {
+            const ssize_t SENT{::send(*it, m_batch.data(), LENGTH, MSG_DONTWAIT | MSG_NOSIGNAL)};
+            if (0 > SENT) {
+                if (EINTR == errno) {
+                    continue;
+                }
+                // Too slow (EAGAIN) or gone (EPIPE, ECONNRESET).
+                if ( (EAGAIN == errno) || (EWOULDBLOCK == errno) ) {
+                    m_dropped++;
+                }
+                ::close(*it);
+                it = m_subscribers.erase(it);
+                continue;
+            }
+            it++;
+        }
+        m_pending = 0;
+    }
+    m_numberOfSubscribers.store(m_subscribers.size(), std::memory_order_relaxed);
+}
+
+std::size_t NavStateServer::subscribers() const noexcept {
+    return m_numberOfSubscribers.load(std::memory_order_relaxed);
+}
+
+uint64_t NavStateServer::dropped() const noexcept {
+    return m_dropped.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NAV_STATE_SERVER
+#define NAV_STATE_SERVER
+
+#include "nav-state-record.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Serves NavStateRecords to any number of local subscribers through an
+ * AF_UNIX SOCK_SEQPACKET socket. Records are collected with add(), and
+ * flush() sends all collected records as one packet (an array of
+ * NavStateRecord) with one non-blocking send() per subscriber. Subscribers
+ * that cannot keep up, i.e., whose socket buffer is full, are disconnected
+ * instead of delaying the caller. New subscribers are accepted on a
+ * separate thread and picked up by the next flush().
+ * Not thread-safe: add() and flush() must be called from one thread.
+ */
+class NavStateServer {
+   private:
+    NavStateServer(const NavStateServer &) = delete;
+    NavStateServer(NavStateServer &&)      = delete;
+    NavStateServer &operator=(const NavStateServer &) = delete;
+    NavStateServer &operator=(NavStateServer &&) = delete;
+
+   public:
+    /**
+     * Constructor.
+     *
+     * @param path File system path of the socket, or @name for the abstract namespace.
+     */
+    explicit NavStateServer(const std::string &path) noexcept;
+    ~NavStateServer() noexcept;
+
+    /**
+     * @return true if the socket could be bound.
+     */
+    bool isValid() const noexcept;
+
+    /**
+     * Collect a record for the next flush(); flushes when the batch is full.
+     *
+     * @param record Record to send.
+     */
+    void add(const NavStateRecord &record) noexcept;
+
+    /**
+     * Send all collected records to all subscribers.
+     */
+    void flush() noexcept;
+
+    /**
+     * @return Number of connected subscribers as of the last flush().
+     */
+    std::size_t subscribers() const noexcept;
+
+    /**
+     * @return Number of subscribers disconnected as they could not keep up.
+     */
+    uint64_t dropped() const noexcept;
+
+   private:
+    void accept() noexcept;
+
+   private:
+    static constexpr std::size_t BATCH{64};
+
+    int32_t m_socket{-1};
+    std::string m_path{};
+
+    std::array<NavStateRecord, BATCH> m_batch{};
+    std::size_t m_pending{0};
+    std::vector<int32_t> m_subscribers{};
+    std::atomic<std::size_t> m_numberOfSubscribers{0};
+    std::atomic<uint64_t> m_dropped{0};
+
+    // Accepted by the acceptor thread, not yet sent to.
+    std::mutex m_acceptedMutex{};
+    std::vector<int32_t> m_accepted{};
+    std::atomic<bool> m_hasAccepted{false};
+    std::atomic<bool> m_running{false};
+    std::thread m_acceptor{};
+};
+
+#endif
@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NAV_STATE
+#define NAV_STATE
+
+#include "ncom-decoder.hpp"
+#include "nav-state-record.hpp"
+#include "opendlv-device-gps-ncom-message-set.hpp"
+
+#include <cmath>
+#include <cstdint>
+
+/**
+ * Decoded navigation state of one NCOM packet as handed from the receiving
+ * to the publishing stage.
+ */
+class NavState {
+   public:
+    cluon::data::TimeStamp sampleTime{};
+    cluon::data::TimeStamp received{};
+    uint32_t senderStamp{0};
+    NCOMDecoder::NCOMMessages messages{};
+
+   public:
+    /**
+     * @return Complete navigation state as one compound message; unlike
+     *         Equilibrioception (north, west, up), velocities are in north,
+     *         east, down.
+     */
+    opendlv::device::gps::ncom::NavState compound() const noexcept {
+        opendlv::device::gps::ncom::NavState msg;
+        msg.latitude(messages.position.latitude())
+           .longitude(messages.position.longitude())
+           .altitude(messages.altitude.altitude())
+           .heading(messages.heading.northHeading())
+           .pitch(messages.pitch)
+           .roll(messages.roll)
+           .velocityNorth(messages.equilibrioception.vx())
+           .velocityEast(-messages.equilibrioception.vy())
+           .velocityDown(-messages.equilibrioception.vz())
+           .groundSpeed(messages.speed.groundSpeed())
+           .accelerationX(messages.acceleration.accelerationX())
+           .accelerationY(messages.acceleration.accelerationY())
+           .accelerationZ(messages.acceleration.accelerationZ())
+           .angularVelocityX(messages.angularVelocity.angularVelocityX())
+           .angularVelocityY(messages.angularVelocity.angularVelocityY())
+           .angularVelocityZ(messages.angularVelocity.angularVelocityZ());
+        return msg;
+    }
+
+    /**
+     * @return Attitude from heading, pitch, and roll including quaternion and rotation matrix.
+     */
+    opendlv::device::gps::ncom::Attitude attitude() const noexcept {
+        const float YAW{messages.heading.northHeading()};
+        const float PITCH{messages.pitch};
+        const float ROLL{messages.roll};
+
+        const float CY{std::cos(YAW)};
+        const float SY{std::sin(YAW)};
+        const float CP{std::cos(PITCH)};
+        const float SP{std::sin(PITCH)};
+        const float CR{std::cos(ROLL)};
+        const float SR{std::sin(ROLL)};
+
+        const float CY2{std::cos(YAW / 2.0f)};
+        const float SY2{std::sin(YAW / 2.0f)};
+        const float CP2{std::cos(PITCH / 2.0f)};
+        const float SP2{std::sin(PITCH / 2.0f)};
+        const float CR2{std::cos(ROLL / 2.0f)};
+        const float SR2{std::sin(ROLL / 2.0f)};
+
+        opendlv::device::gps::ncom::Attitude msg;
+        msg.roll(ROLL)
+           .pitch(PITCH)
+           .yaw(YAW)
+           .qw(CR2 * CP2 * CY2 + SR2 * SP2 * SY2)
+           .qx(SR2 * CP2 * CY2 - CR2 * SP2 * SY2)
+           .qy(CR2 * SP2 * CY2 + SR2 * CP2 * SY2)
+           .qz(CR2 * CP2 * SY2 - SR2 * SP2 * CY2)
+           .r11(CP * CY)
+           .r12(SR * SP * CY - CR * SY)
+           .r13(CR * SP * CY + SR * SY)
+           .r21(CP * SY)
+           .r22(SR * SP * SY + CR * CY)
+           .r23(CR * SP * SY - SR * CY)
+           .r31(-SP)
+           .r32(SR * CP)
+           .r33(CR * CP);
+        return msg;
+    }
+
+    /**
+     * @return Compact binary navigation state for local consumers; velocities
+     *         are in north, east, down as in compound().
+     */
+    NavStateRecord record() const noexcept {
+        NavStateRecord r;
+        r.senderStamp = senderStamp;
+        r.sampleTime = cluon::time::toMicroseconds(sampleTime);
+        r.received = cluon::time::toMicroseconds(received);
+        r.latitude = messages.position.latitude();
+        r.longitude = messages.position.longitude();
+        r.altitude = messages.altitude.altitude();
+        r.heading = messages.heading.northHeading();
+        r.pitch = messages.pitch;
+        r.roll = messages.roll;
+        r.velocityNorth = messages.equilibrioception.vx();
+        r.velocityEast = -messages.equilibrioception.vy();
+        r.velocityDown = -messages.equilibrioception.vz();
+        r.groundSpeed = messages.speed.groundSpeed();
+        r.accelerationX = messages.acceleration.accelerationX();
+        r.accelerationY = messages.acceleration.accelerationY();
+        r.accelerationZ = messages.acceleration.accelerationZ();
+        r.angularVelocityX = messages.angularVelocity.angularVelocityX();
+        r.angularVelocityY = messages.angularVelocity.angularVelocityY();
+        r.angularVelocityZ = messages.angularVelocity.angularVelocityZ();
+        return r;
+    }
+};
+
+#endif
@@ -23,42 +23,40 @@
 #include <ctime>
 #include <array>
 #include <iostream>
-#include <sstream>
 #include <string>
 
 std::pair<bool, NCOMDecoder::NCOMMessages> NCOMDecoder::decode(const std::string &data) noexcept {
+    return decode(data.data(), data.size());
+}
+
+std::pair<bool, NCOMDecoder::NCOMMessages> NCOMDecoder::decode(const char *data, std::size_t length) noexcept {
     bool retVal{false};
     NCOMDecoder::NCOMMessages msg;
 
     const constexpr std::size_t NCOM_PACKET_LENGTH{72};
     const constexpr uint8_t NCOM_FIRST_BYTE{0xE7};
-    if ( (NCOM_PACKET_LENGTH == data.size()) && (NCOM_FIRST_BYTE == static_cast<uint8_t>(data.at(0))) ) {
-        std::stringstream buffer{data};
-
+    if ( (nullptr != data) && (NCOM_PACKET_LENGTH == length) && (NCOM_FIRST_BYTE == static_cast<uint8_t>(data[0])) ) {
         // Time stamping.
         {
             // Test for channel 0 that has complete time stamp.
             {
                 const constexpr uint32_t START_OF_CHANNEL{62};
-                buffer.seekg(START_OF_CHANNEL);
                 char channel{0};
-                buffer.read(&channel, sizeof(char));
+                std::memcpy(&channel, data + START_OF_CHANNEL, sizeof(char));
                 if (0 == channel) {
                     const constexpr uint32_t START_OF_GPSMINUTES{63};
-                    buffer.seekg(START_OF_GPSMINUTES);
-                    buffer.read(reinterpret_cast<char*>(&m_gpsMinutes), sizeof(uint32_t));
+                    std::memcpy(&m_gpsMinutes, data + START_OF_GPSMINUTES, sizeof(uint32_t));
                     m_gpsMinutes = le32toh(m_gpsMinutes);
                 }
             }
 
             // When we have a GPS minute from a previous run:
             if (0 < m_gpsMinutes) {
-                // Move to where the timestamp is encoded as we have a valid GPS
+                // Read the timestamp from where it is encoded as we have a valid GPS
                 // minute time stamp either from the current cycle or from a previous one.
                 const constexpr uint32_t START_OF_TIMESTAMP{1};
                 uint16_t millisecondsIntoCurrentGPSMinute{0};
-                buffer.seekg(START_OF_TIMESTAMP);
-                buffer.read(reinterpret_cast<char*>(&(millisecondsIntoCurrentGPSMinute)), sizeof(uint16_t));
+                std::memcpy(&millisecondsIntoCurrentGPSMinute, data + START_OF_TIMESTAMP, sizeof(uint16_t));
                 millisecondsIntoCurrentGPSMinute = le16toh(millisecondsIntoCurrentGPSMinute);
 
                 const constexpr int32_t GPS_EPOCH_OFFSET{315964800};
@@ -76,12 +74,11 @@ std::pair<bool, NCOMDecoder::NCOMMessages> NCOMDecoder::decode(const std::string
             std::array<char, 4> tmp{0, 0, 0, 0};
             int32_t value{0};
             {
-                // Move to where acceleration X is encoded.
+                // Offset where acceleration X is encoded.
                 const constexpr uint32_t START_OF_ACCELERATIONX{3};
-                buffer.seekg(START_OF_ACCELERATIONX);
 
                 // Extract only three bytes from NCOM.
-                buffer.read(tmp.data(), 3);
+                std::memcpy(tmp.data(), data + START_OF_ACCELERATIONX, 3);
                 std::memcpy(&value, tmp.data(), 4);
                 value = le32toh(value) & 0xFFFFFF;
                 if ((value & 0x800000) == 0x800000) {
@@ -90,12 +87,11 @@ std::pair<bool, NCOMDecoder::NCOMMessages> NCOMDecoder::decode(const std::string
                 accelerationX = value * 1e-4f;
             }
             {
-                // Move to where acceleration Y is encoded.
+                // Offset where acceleration Y is encoded.
                 const constexpr uint32_t START_OF_ACCELERATIONY{6};
-                buffer.seekg(START_OF_ACCELERATIONY);
 
                 // Extract only three bytes from NCOM.
-                buffer.read(tmp.data(), 3);
+                std::memcpy(tmp.data(), data + START_OF_ACCELERATIONY, 3);
                 std::memcpy(&value, tmp.data(), 4);
                 value = le32toh(value) & 0xFFFFFF;
                 if ((value & 0x800000) == 0x800000) {
@@ -104,12 +100,11 @@ std::pair<bool, NCOMDecoder::NCOMMessages> NCOMDecoder::decode(const std::string
                 accelerationY = value * 1e-4f;
             }
             {
-                // Move to where acceleration Z is encoded.
+                // Offset where acceleration Z is encoded.
                 const constexpr uint32_t START_OF_ACCELERATIONZ{9};
-                buffer.seekg(START_OF_ACCELERATIONZ);
 
                 // Extract only three bytes from NCOM.
-                buffer.read(tmp.data(), 3);
+                std::memcpy(tmp.data(), data + START_OF_ACCELERATIONZ, 3);
                 std::memcpy(&value, tmp.data(), 4);
                 value = le32toh(value) & 0xFFFFFF;
                 if ((value & 0x800000) == 0x800000) {
@@ -133,12 +128,11 @@ std::pair<bool, NCOMDecoder::NCOMMessages> NCOMDecoder::decode(const std::string
             std::array<char, 4> tmp{0, 0, 0, 0};
             int32_t value{0};
             {
-                // Move to where angular rate X is encoded.
+                // Offset where angular rate X is encoded.
                 const constexpr uint32_t START_OF_ANGULARRATEX{12};
-                buffer.seekg(START_OF_ANGULARRATEX);
 
                 // Extract only three bytes from NCOM.
-                buffer.read(tmp.data(), 3);
+                std::memcpy(tmp.data(), data + START_OF_ANGULARRATEX, 3);
                 std::memcpy(&value, tmp.data(), 4);
                 value = le32toh(value) & 0xFFFFFF;
                 if ((value & 0x800000) == 0x800000) {
@@ -147,12 +141,11 @@ std::pair<bool, NCOMDecoder::NCOMMessages> NCOMDecoder::decode(const std::string
                 angularRateX = value * 1e-5f;
             }
             {
-                // Move to where angular rate Y is encoded.
+                // Offset where angular rate Y is encoded.
                 const constexpr uint32_t START_OF_ANGULARRATEY{15};
-                buffer.seekg(START_OF_ANGULARRATEY);
 
                 // Extract only three bytes from NCOM.
-                buffer.read(tmp.data(), 3);
+                std::memcpy(tmp.data(), data + START_OF_ANGULARRATEY, 3);
                 std::memcpy(&value, tmp.data(), 4);
                 value = le32toh(value) & 0xFFFFFF;
                 if ((value & 0x800000) == 0x800000) {
@@ -161,12 +154,11 @@ std::pair<bool, NCOMDecoder::NCOMMessages> NCOMDecoder::decode(const std::string
                 angularRateY = value * 1e-5f;
             }
             {
-                // Move to where angular rate Z is encoded.
+                // Offset where angular rate Z is encoded.
                 const constexpr uint32_t START_OF_ANGULARRATEZ{18};
-                buffer.seekg(START_OF_ANGULARRATEZ);
 
                 // Extract only three bytes from NCOM.
-                buffer.read(tmp.data(), 3);
+                std::memcpy(tmp.data(), data + START_OF_ANGULARRATEZ, 3);
                 std::memcpy(&value, tmp.data(), 4);
                 value = le32toh(value) & 0xFFFFFF;
                 if ((value & 0x800000) == 0x800000) {
@@ -191,11 +183,10 @@ std::pair<bool, NCOMDecoder::NCOMMessages> NCOMDecoder::decode(const std::string
             double latitude{0.0};
             double longitude{0.0};
 
-            // Move to where latitude/longitude are encoded.
+            // Offset where latitude/longitude are encoded.
             const constexpr uint32_t START_OF_LAT_LON{23};
-            buffer.seekg(START_OF_LAT_LON);
-            buffer.read(reinterpret_cast<char*>(&latitude), sizeof(double));
-            buffer.read(reinterpret_cast<char*>(&longitude), sizeof(double));
+            std::memcpy(&latitude, data + START_OF_LAT_LON, sizeof(double));
+            std::memcpy(&longitude, data + START_OF_LAT_LON + sizeof(double), sizeof(double));
 
             msg.position.latitude(latitude / M_PI * 180.0).longitude(longitude / M_PI * 180.0);
 
@@ -211,10 +202,9 @@ std::pair<bool, NCOMDecoder::NCOMMessages> NCOMDecoder::decode(const std::string
         {
             float altitude{0.0f};
 
-            // Move to where altitude is encoded.
+            // Offset where altitude is encoded.
             const constexpr uint32_t START_OF_ALT{39};
-            buffer.seekg(START_OF_ALT);
-            buffer.read(reinterpret_cast<char*>(&altitude), sizeof(float));
+            std::memcpy(&altitude, data + START_OF_ALT, sizeof(float));
 
             msg.altitude.altitude(altitude);
 
@@ -232,12 +222,11 @@ std::pair<bool, NCOMDecoder::NCOMMessages> NCOMDecoder::decode(const std::string
             std::array<char, 4> tmp{0, 0, 0, 0};
             int32_t value{0};
             {
-                // Move to where north velocity is encoded.
+                // Offset where north velocity is encoded.
                 const constexpr uint32_t START_OF_NORTH_VELOCITY{43};
-                buffer.seekg(START_OF_NORTH_VELOCITY);
 
                 // Extract only three bytes from NCOM.
-                buffer.read(tmp.data(), 3);
+                std::memcpy(tmp.data(), data + START_OF_NORTH_VELOCITY, 3);
                 std::memcpy(&value, tmp.data(), 4);
                 value = le32toh(value) & 0xFFFFFF;
                 if ((value & 0x800000) == 0x800000) {
@@ -246,12 +235,11 @@ std::pair<bool, NCOMDecoder::NCOMMessages> NCOMDecoder::decode(const std::string
                 northVelocity = value * 1e-4f;
             }
             {
-                // Move to where east velocity is encoded.
+                // Offset where east velocity is encoded.
                 const constexpr uint32_t START_OF_EAST_VELOCITY{46};
-                buffer.seekg(START_OF_EAST_VELOCITY);
 
                 // Extract only three bytes from NCOM.
-                buffer.read(tmp.data(), 3);
+                std::memcpy(tmp.data(), data + START_OF_EAST_VELOCITY, 3);
                 std::memcpy(&value, tmp.data(), 4);
                 value = le32toh(value) & 0xFFFFFF;
                 if ((value & 0x800000) == 0x800000) {
@@ -260,12 +248,11 @@ std::pair<bool, NCOMDecoder::NCOMMessages> NCOMDecoder::decode(const std::string
                 eastVelocity = value * -1e-4f;
             }
             {
-                // Move to where down velocity is encoded.
+                // Offset where down velocity is encoded.
                 const constexpr uint32_t START_OF_DOWN_VELOCITY{49};
-                buffer.seekg(START_OF_DOWN_VELOCITY);
 
                 // Extract only three bytes from NCOM.
-                buffer.read(tmp.data(), 3);
+                std::memcpy(tmp.data(), data + START_OF_DOWN_VELOCITY, 3);
                 std::memcpy(&value, tmp.data(), 4);
                 value = le32toh(value) & 0xFFFFFF;
                 if ((value & 0x800000) == 0x800000) {
@@ -287,16 +274,18 @@ std::pair<bool, NCOMDecoder::NCOMMessages> NCOMDecoder::decode(const std::string
         {
             float heading{0.0f};
 
-            // Move to where heading is encoded.
+            // Offset where heading is encoded.
             const constexpr uint32_t START_OF_HEADING{52};
-            buffer.seekg(START_OF_HEADING);
 
             // Extract only three bytes from NCOM.
             std::array<char, 4> tmp{0, 0, 0, 0};
-            buffer.read(tmp.data(), 3);
-            uint32_t value{0};
+            std::memcpy(tmp.data(), data + START_OF_HEADING, 3);
+            int32_t value{0};
             std::memcpy(&value, tmp.data(), 4);
-            value = le32toh(value);
+            value = le32toh(value) & 0xFFFFFF;
+            if ((value & 0x800000) == 0x800000) {
+                value = -1 * ((~value & 0xFFFFFF) + 1);
+            }
             heading = value * 1e-6f;
 
             // Normalize between -M_PI .. M_PI.
@@ -318,16 +307,18 @@ std::pair<bool, NCOMDecoder::NCOMMessages> NCOMDecoder::decode(const std::string
         {
             float pitch{0.0f};
 
-            // Move to where pitch is encoded.
+            // Offset where pitch is encoded.
             const constexpr uint32_t START_OF_PITCH{55};
-            buffer.seekg(START_OF_PITCH);
 
             // Extract only three bytes from NCOM.
             std::array<char, 4> tmp{0, 0, 0, 0};
-            buffer.read(tmp.data(), 3);
-            uint32_t value{0};
+            std::memcpy(tmp.data(), data + START_OF_PITCH, 3);
+            int32_t value{0};
             std::memcpy(&value, tmp.data(), 4);
-            value = le32toh(value);
+            value = le32toh(value) & 0xFFFFFF;
+            if ((value & 0x800000) == 0x800000) {
+                value = -1 * ((~value & 0xFFFFFF) + 1);
+            }
             pitch = value * 1e-6f;
 
             // Normalize between -M_PI/2.0 .. M_PI/2.0.
@@ -346,16 +337,18 @@ std::pair<bool, NCOMDecoder::NCOMMessages> NCOMDecoder::decode(const std::string
         {
             float roll{0.0f};
 
-            // Move to where roll is encoded.
+            // Offset where roll is encoded.
             const constexpr uint32_t START_OF_ROLL{58};
-            buffer.seekg(START_OF_ROLL);
 
             // Extract only three bytes from NCOM.
             std::array<char, 4> tmp{0, 0, 0, 0};
-            buffer.read(tmp.data(), 3);
-            uint32_t value{0};
+            std::memcpy(tmp.data(), data + START_OF_ROLL, 3);
+            int32_t value{0};
             std::memcpy(&value, tmp.data(), 4);
-            value = le32toh(value);
+            value = le32toh(value) & 0xFFFFFF;
+            if ((value & 0x800000) == 0x800000) {
+                value = -1 * ((~value & 0xFFFFFF) + 1);
+            }
             roll = value * 1e-6f;
 
             // Normalize between -M_PI .. M_PI.
@@ -369,6 +362,45 @@ std::pair<bool, NCOMDecoder::NCOMMessages> NCOMDecoder::decode(const std::string
             msg.roll = roll;
             retVal &= true;
         }
+
+        // Decode status; only one status channel is contained per packet.
+        {
+            const constexpr uint32_t START_OF_NAVIGATION_STATUS{21};
+            m_status.navigationStatus(static_cast<uint8_t>(data[START_OF_NAVIGATION_STATUS]));
+
+            const constexpr uint32_t START_OF_CHANNEL{62};
+            const constexpr uint32_t START_OF_STATUS{63};
+            // Accuracies are only valid if their age is below 150.
+            const constexpr uint32_t START_OF_AGE{69};
+            const constexpr uint8_t MAX_AGE{150};
+            auto accuracyAt = [data](uint32_t offset, float scale) {
+                uint16_t value{0};
+                std::memcpy(&value, data + offset, sizeof(uint16_t));
+                return le16toh(value) * scale;
+            };
+
+            const uint8_t CHANNEL{static_cast<uint8_t>(data[START_OF_CHANNEL])};
+            const bool VALID_AGE{MAX_AGE > static_cast<uint8_t>(data[START_OF_AGE])};
+            if (0 == CHANNEL) {
+                m_status.satellites(static_cast<uint8_t>(data[START_OF_STATUS + 4]))
+                        .positionMode(static_cast<uint8_t>(data[START_OF_STATUS + 5]))
+                        .velocityMode(static_cast<uint8_t>(data[START_OF_STATUS + 6]))
+                        .orientationMode(static_cast<uint8_t>(data[START_OF_STATUS + 7]));
+            } else if ( (3 == CHANNEL) && VALID_AGE ) {
+                m_status.northAccuracy(accuracyAt(START_OF_STATUS, 1e-3f))
+                        .eastAccuracy(accuracyAt(START_OF_STATUS + 2, 1e-3f))
+                        .downAccuracy(accuracyAt(START_OF_STATUS + 4, 1e-3f));
+            } else if ( (4 == CHANNEL) && VALID_AGE ) {
+                m_status.velocityNorthAccuracy(accuracyAt(START_OF_STATUS, 1e-3f))
+                        .velocityEastAccuracy(accuracyAt(START_OF_STATUS + 2, 1e-3f))
+                        .velocityDownAccuracy(accuracyAt(START_OF_STATUS + 4, 1e-3f));
+            } else if ( (5 == CHANNEL) && VALID_AGE ) {
+                m_status.headingAccuracy(accuracyAt(START_OF_STATUS, 1e-5f))
+                        .pitchAccuracy(accuracyAt(START_OF_STATUS + 2, 1e-5f))
+                        .rollAccuracy(accuracyAt(START_OF_STATUS + 4, 1e-5f));
+            }
+            msg.status = m_status;
+        }
     }
     return std::make_pair(retVal, msg);
 }
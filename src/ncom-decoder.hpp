@@ -19,7 +19,9 @@
 #define NCOM_DECODER
 
 #include "opendlv-standard-message-set.hpp"
+#include "opendlv-device-gps-ncom-message-set.hpp"
 
+#include <cstddef>
 #include <string>
 #include <utility>
 
@@ -38,6 +40,8 @@ class NCOMDecoder {
         opendlv::logic::sensation::Equilibrioception equilibrioception{};
         float pitch{0.0f};
         float roll{0.0f};
+        // Status is collected over several packets' status channels.
+        opendlv::device::gps::ncom::Status status{};
     };
 
    private:
@@ -52,9 +56,11 @@ class NCOMDecoder {
 
    public:
     std::pair<bool, NCOMMessages> decode(const std::string &data) noexcept;
+    std::pair<bool, NCOMMessages> decode(const char *data, std::size_t length) noexcept;
 
    private:
     uint32_t m_gpsMinutes{0};
+    opendlv::device::gps::ncom::Status m_status{};
 };
 
 #endif
@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ncom-file-reader.hpp"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <array>
+#include <iostream>
+#include <vector>
+
+namespace {
+// Mapping windows keep address space use bounded on 32-bit platforms.
+constexpr std::size_t WINDOW{64 * 1024 * 1024};
+constexpr std::size_t CHUNK{1024 * 1024};
+}
+
+NCOMFileReader::NCOMFileReader(const std::string &path, Pacing pacing, NCOMUDPReceiver::Delegate delegate) noexcept
+    : m_delegate(std::move(delegate))
+    , m_pacing(pacing)
+    , m_framer([this](const char *data, std::size_t length) {
+        if (Pacing::GPS_TIME == m_pacing) {
+            pace(data);
+        }
+        m_packets.fetch_add(1, std::memory_order_relaxed);
+        if (nullptr != m_delegate) {
+            m_delegate(0, data, length, std::chrono::system_clock::now());
+        }
+    }) {
+    if ("-" == path) {
+        m_fd = STDIN_FILENO;
+    } else {
+        m_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        m_ownsFD = (0 <= m_fd);
+    }
+    if (0 > m_fd) {
+        std::cerr << "[NCOMFileReader] Error while opening " << path << ": " << errno << std::endl;
+        return;
+    }
+
+    m_stopFD = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (0 <= m_stopFD) {
+        m_valid = true;
+        m_readThreadRunning.store(true);
+        m_readThread = std::thread(&NCOMFileReader::read, this);
+    }
+}
+
+NCOMFileReader::~NCOMFileReader() noexcept {
+    m_readThreadRunning.store(false);
+    if (0 <= m_stopFD) {
+        ::eventfd_write(m_stopFD, 1);
+    }
+    try {
+        if (m_readThread.joinable()) {
+            m_readThread.join();
+        }
+    } catch (...) {}
+
+    if (m_ownsFD) {
+        ::close(m_fd);
+    }
+    if (0 <= m_stopFD) {
+        ::close(m_stopFD);
+    }
+}
+
+bool NCOMFileReader::isValid() const noexcept {
+    return m_valid;
+}
+
+bool NCOMFileReader::isRunning() const noexcept {
+    return m_readThreadRunning.load();
+}
+
+uint64_t NCOMFileReader::packets() const noexcept {
+    return m_packets.load(std::memory_order_relaxed);
+}
+
+uint64_t NCOMFileReader::discardedBytes() const noexcept {
+    return m_discardedBytes.load(std::memory_order_relaxed);
+}
+
+void NCOMFileReader::pace(const char *packet) noexcept {
+    // Bytes 1-2 hold the milliseconds into the current GPS minute, which is
+    // enough to derive the time between consecutive packets.
+    constexpr std::size_t START_OF_TIMESTAMP{1};
+    uint16_t millisecondsIntoMinute{0};
+    std::memcpy(&millisecondsIntoMinute, packet + START_OF_TIMESTAMP, sizeof(uint16_t));
+
+    if (0 > m_lastMillisecondsIntoMinute) {
+        m_paceStart = std::chrono::steady_clock::now();
+    } else {
+        const int32_t DELTA{(static_cast<int32_t>(millisecondsIntoMinute) - m_lastMillisecondsIntoMinute + 60000) % 60000};
+        m_paceOffset += std::chrono::milliseconds{DELTA};
+    }
+    m_lastMillisecondsIntoMinute = millisecondsIntoMinute;
+
+    const std::chrono::steady_clock::time_point DUE{m_paceStart + m_paceOffset};
+    while (m_readThreadRunning.load() && (std::chrono::steady_clock::now() < DUE)) {
+        const std::chrono::steady_clock::time_point NEXT{std::chrono::steady_clock::now() + std::chrono::milliseconds{100}};
+        std::this_thread::sleep_until((DUE < NEXT) ? DUE : NEXT);
+    }
+}
+
+void NCOMFileReader::read() noexcept {
+    struct stat s{};
+    if ( (0 == ::fstat(m_fd, &s)) && S_ISREG(s.st_mode) ) {
+        readMapped();
+    } else {
+        readStream();
+    }
+    m_framer.reset();
+    m_discardedBytes.store(m_framer.discardedBytes(), std::memory_order_relaxed);
+    m_readThreadRunning.store(false);
+}
+
+void NCOMFileReader::readMapped() noexcept {
+    struct stat s{};
+    ::fstat(m_fd, &s);
+    const std::size_t SIZE{static_cast<std::size_t>(s.st_size)};
+    for (std::size_t offset{0}; m_readThreadRunning.load() && (offset < SIZE); offset += WINDOW) {
+        const std::size_t LENGTH{(offset + WINDOW < SIZE) ? WINDOW : SIZE - offset};
+        void *window = ::mmap(nullptr, LENGTH, PROT_READ, MAP_PRIVATE, m_fd, static_cast<off_t>(offset));
+        if (MAP_FAILED == window) {
+            std::cerr << "[NCOMFileReader] Error while mapping file: " << errno << std::endl;
+            return;
+        }
+        ::madvise(window, LENGTH, MADV_SEQUENTIAL);
+        ::madvise(window, LENGTH, MADV_WILLNEED);
+
+        // Frame in chunks to stay responsive to stop requests.
+        const char *data = static_cast<const char *>(window);
+        for (std::size_t i{0}; m_readThreadRunning.load() && (i < LENGTH); i += CHUNK) {
+            m_framer.feed(data + i, (i + CHUNK < LENGTH) ? CHUNK : LENGTH - i);
+            m_discardedBytes.store(m_framer.discardedBytes(), std::memory_order_relaxed);
+        }
+        ::munmap(window, LENGTH);
+    }
+}
+
+void NCOMFileReader::readStream() noexcept {
+    std::array<struct pollfd, 2> fds{};
+    fds[0].fd = m_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = m_stopFD;
+    fds[1].events = POLLIN;
+
+    std::vector<char> buffer(CHUNK);
+    while (m_readThreadRunning.load()) {
+        if (0 > ::poll(fds.data(), fds.size(), -1)) {
+            if (EINTR == errno) {
+                continue;
+            }
+            std::cerr << "[NCOMFileReader] Error while waiting for data: " << errno << std::endl;
+            break;
+        }
+        if (0 != (fds[1].revents & POLLIN)) {
+            break;
+        }
+
+        const ssize_t N{::read(m_fd, buffer.data(), buffer.size())};
+        if (0 > N) {
+            if ( (EINTR == errno) || (EAGAIN == errno) ) {
+                continue;
+            }
+            std::cerr << "[NCOMFileReader] Error while reading: " << errno << std::endl;
+            break;
+        }
+        if (0 == N) {
+            // End of input (e.g., all writers closed the pipe).
+            break;
+        }
+        m_framer.feed(buffer.data(), static_cast<std::size_t>(N));
+        m_discardedBytes.store(m_framer.discardedBytes(), std::memory_order_relaxed);
+    }
+}
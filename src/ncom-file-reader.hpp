@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NCOM_FILE_READER
+#define NCOM_FILE_READER
+
+#include "ncom-framer.hpp"
+#include "ncom-udp-receiver.hpp"
+
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+/**
+ * Reads raw NCOM bytes from a file, a named pipe, or stdin. Regular files
+ * are memory-mapped in large windows, pipes are read in large chunks; the
+ * packets are framed in place. Packets are either handed over as fast as
+ * possible or paced by the GPS time embedded in each packet.
+ */
+class NCOMFileReader {
+   public:
+    enum class Pacing : uint8_t {
+        MAX_SPEED,
+        GPS_TIME,
+    };
+
+   private:
+    NCOMFileReader(const NCOMFileReader &) = delete;
+    NCOMFileReader(NCOMFileReader &&)      = delete;
+    NCOMFileReader &operator=(const NCOMFileReader &) = delete;
+    NCOMFileReader &operator=(NCOMFileReader &&) = delete;
+
+   public:
+    /**
+     * Constructor.
+     *
+     * @param path File or named pipe to read from; "-" for stdin.
+     * @param pacing How fast to hand over packets.
+     * @param delegate Functional to handle packets; the unit is always 0 and
+     *                 the time stamp is when the packet was handed over.
+     */
+    NCOMFileReader(const std::string &path, Pacing pacing, NCOMUDPReceiver::Delegate delegate) noexcept;
+    ~NCOMFileReader() noexcept;
+
+    /**
+     * @return true if the input could be opened; stays true after the end of the input.
+     */
+    bool isValid() const noexcept;
+
+    /**
+     * @return true until the end of the input is reached.
+     */
+    bool isRunning() const noexcept;
+
+    /**
+     * @return Number of packets handed over so far.
+     */
+    uint64_t packets() const noexcept;
+
+    /**
+     * @return Number of bytes skipped while searching for packet boundaries.
+     */
+    uint64_t discardedBytes() const noexcept;
+
+   private:
+    void read() noexcept;
+    void readMapped() noexcept;
+    void readStream() noexcept;
+    void pace(const char *packet) noexcept;
+
+   private:
+    NCOMUDPReceiver::Delegate m_delegate{};
+    Pacing m_pacing{Pacing::MAX_SPEED};
+    int32_t m_fd{-1};
+    bool m_ownsFD{false};
+    int32_t m_stopFD{-1};
+
+    std::chrono::steady_clock::time_point m_paceStart{};
+    std::chrono::milliseconds m_paceOffset{0};
+    int32_t m_lastMillisecondsIntoMinute{-1};
+    NCOMFramer m_framer;
+
+    std::atomic<uint64_t> m_packets{0};
+    std::atomic<uint64_t> m_discardedBytes{0};
+
+    bool m_valid{false};
+    std::atomic<bool> m_readThreadRunning{false};
+    std::thread m_readThread{};
+};
+
+#endif
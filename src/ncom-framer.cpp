@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ncom-framer.hpp"
+
+#include <cstring>
+
+constexpr std::size_t NCOMFramer::PACKET_LENGTH;
+constexpr uint8_t NCOMFramer::SYNC;
+
+NCOMFramer::NCOMFramer(Delegate delegate) noexcept
+    : m_delegate(std::move(delegate)) {}
+
+uint64_t NCOMFramer::discardedBytes() const noexcept {
+    return m_discardedBytes;
+}
+
+void NCOMFramer::reset() noexcept {
+    m_discardedBytes += m_partialLength;
+    m_partialLength = 0;
+}
+
+bool NCOMFramer::isValid(const char *packet) noexcept {
+    // Checksum 1 covers bytes 1-21 (batch A), checksum 2 bytes 1-60
+    // (batch B), and checksum 3 bytes 1-70 (status channel).
+    constexpr std::size_t CHECKSUM1{22};
+    constexpr std::size_t CHECKSUM2{61};
+    constexpr std::size_t CHECKSUM3{71};
+
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(packet);
+    if (SYNC != p[0]) {
+        return false;
+    }
+    uint8_t sum{0};
+    std::size_t i{1};
+    for (; i < CHECKSUM1; i++) {
+        sum = static_cast<uint8_t>(sum + p[i]);
+    }
+    if (sum != p[CHECKSUM1]) {
+        return false;
+    }
+    for (; i < CHECKSUM2; i++) {
+        sum = static_cast<uint8_t>(sum + p[i]);
+    }
+    if (sum != p[CHECKSUM2]) {
+        return false;
+    }
+    for (; i < CHECKSUM3; i++) {
+        sum = static_cast<uint8_t>(sum + p[i]);
+    }
+    return (sum == p[CHECKSUM3]);
+}
+
+void NCOMFramer::feed(const char *data, std::size_t length) noexcept {
+    while (0 < length) {
+        if (0 < m_partialLength) {
+            // Complete the packet started by previous bytes.
+            const std::size_t MISSING{PACKET_LENGTH - m_partialLength};
+            const std::size_t N{(MISSING < length) ? MISSING : length};
+            std::memcpy(m_partial.data() + m_partialLength, data, N);
+            m_partialLength += N;
+            data += N;
+            length -= N;
+            if (PACKET_LENGTH > m_partialLength) {
+                return;
+            }
+
+            if (isValid(m_partial.data())) {
+                if (nullptr != m_delegate) {
+                    m_delegate(m_partial.data(), PACKET_LENGTH);
+                }
+                m_partialLength = 0;
+            } else {
+                // Resynchronize on the next sync byte within the buffer.
+                const void *next = std::memchr(m_partial.data() + 1, SYNC, PACKET_LENGTH - 1);
+                const std::size_t SKIP{(nullptr == next) ? PACKET_LENGTH : static_cast<std::size_t>(static_cast<const char *>(next) - m_partial.data())};
+                std::memmove(m_partial.data(), m_partial.data() + SKIP, PACKET_LENGTH - SKIP);
+                m_partialLength = PACKET_LENGTH - SKIP;
+                m_discardedBytes += SKIP;
+            }
+            continue;
+        }
+
+        const void *sync = std::memchr(data, SYNC, length);
+        if (nullptr == sync) {
+            m_discardedBytes += length;
+            return;
+        }
+        const std::size_t SKIP{static_cast<std::size_t>(static_cast<const char *>(sync) - data)};
+        m_discardedBytes += SKIP;
+        data += SKIP;
+        length -= SKIP;
+
+        if (PACKET_LENGTH > length) {
+            std::memcpy(m_partial.data(), data, length);
+            m_partialLength = length;
+            return;
+        }
+        if (isValid(data)) {
+            if (nullptr != m_delegate) {
+                m_delegate(data, PACKET_LENGTH);
+            }
+            data += PACKET_LENGTH;
+            length -= PACKET_LENGTH;
+        } else {
+            m_discardedBytes++;
+            data++;
+            length--;
+        }
+    }
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NCOM_FRAMER
+#define NCOM_FRAMER
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <functional>
+
+/**
+ * Finds NCOM packets in a byte stream (e.g., serial line or TCP) by their
+ * sync byte and the three checksums. Packets lying completely within the
+ * data passed to feed() are handed to the delegate in place; only packets
+ * spanning two calls are assembled in an internal buffer.
+ */
+class NCOMFramer {
+   public:
+    static constexpr std::size_t PACKET_LENGTH{72};
+    static constexpr uint8_t SYNC{0xE7};
+
+    /**
+     * Delegate called for each complete packet with data and length.
+     */
+    using Delegate = std::function<void(const char *, std::size_t)>;
+
+   private:
+    NCOMFramer(const NCOMFramer &) = delete;
+    NCOMFramer(NCOMFramer &&)      = delete;
+    NCOMFramer &operator=(const NCOMFramer &) = delete;
+    NCOMFramer &operator=(NCOMFramer &&) = delete;
+
+   public:
+    explicit NCOMFramer(Delegate delegate) noexcept;
+    ~NCOMFramer() = default;
+
+   public:
+    /**
+     * Process the next bytes from the stream.
+     *
+     * @param data Bytes received.
+     * @param length Number of bytes.
+     */
+    void feed(const char *data, std::size_t length) noexcept;
+
+    /**
+     * Drop a partially received packet (e.g., when the stream was interrupted).
+     */
+    void reset() noexcept;
+
+    /**
+     * @return Number of bytes skipped while searching for packet boundaries.
+     */
+    uint64_t discardedBytes() const noexcept;
+
+    /**
+     * @param packet PACKET_LENGTH bytes to check.
+     * @return true if sync byte and all three checksums match.
+     */
+    static bool isValid(const char *packet) noexcept;
+
+   private:
+    Delegate m_delegate{};
+    std::array<char, PACKET_LENGTH> m_partial{};
+    std::size_t m_partialLength{0};
+    uint64_t m_discardedBytes{0};
+};
+
+#endif
@@ -0,0 +1,253 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ncom-packet-capture.hpp"
+#include "ncom-relay.hpp"
+
+#include <arpa/inet.h>
+#include <linux/filter.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <net/if.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <array>
+#include <iostream>
+
+NCOMPacketCapture::NCOMPacketCapture(const std::string &interfaceName, const std::vector<NCOMUDPReceiver::Unit> &units, NCOMUDPReceiver::Delegate delegate, NCOMRelay *relay) noexcept
+    : m_delegate(std::move(delegate))
+    , m_relay(relay) {
+    for (const auto &unit : units) {
+        struct in_addr address{};
+        if ( (0 == unit.port) || (1 != ::inet_pton(AF_INET, unit.address.c_str(), &address)) ) {
+            std::cerr << "[NCOMPacketCapture] Invalid address " << unit.address << ":" << unit.port << std::endl;
+            return;
+        }
+        m_ports.push_back(unit.port);
+        m_addresses.push_back(ntohl(address.s_addr));
+    }
+    const uint32_t INTERFACE{::if_nametoindex(interfaceName.c_str())};
+    if (m_ports.empty() || (0 == INTERFACE)) {
+        std::cerr << "[NCOMPacketCapture] Invalid interface '" << interfaceName << "' or no units given." << std::endl;
+        return;
+    }
+
+    // Cooked socket: Frames are delivered starting at the IP header. The
+    // protocol is set only when binding to not capture frames before the
+    // filter is in place.
+    m_socket = ::socket(AF_PACKET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (0 > m_socket) {
+        std::cerr << "[NCOMPacketCapture] Error while creating AF_PACKET socket (CAP_NET_RAW needed): " << errno << std::endl;
+        return;
+    }
+
+    // Classic BPF program on the IP header: Pass only incoming, unfragmented
+    // UDP datagrams to one of the units' ports. A datagram is fragmented if
+    // the more-fragments flag (0x2000) or the fragment offset (0x1fff) is set.
+    {
+        const uint8_t PORTS{static_cast<uint8_t>(m_ports.size())};
+        const uint8_t DROP{static_cast<uint8_t>(8 + PORTS)};
+        const uint8_t ACCEPT{static_cast<uint8_t>(DROP + 1)};
+        std::vector<struct sock_filter> program{
+            BPF_STMT(BPF_LD | BPF_W | BPF_ABS, static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_PKTTYPE)),
+            BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, PACKET_OUTGOING, static_cast<uint8_t>(DROP - 2), 0),
+            BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 9),
+            BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_UDP, 0, static_cast<uint8_t>(DROP - 4)),
+            BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 6),
+            BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x3fff, static_cast<uint8_t>(DROP - 6), 0),
+            BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 0),
+            BPF_STMT(BPF_LD | BPF_H | BPF_IND, 2),
+        };
+        for (uint8_t i{0}; i < PORTS; i++) {
+            program.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, m_ports[i], static_cast<uint8_t>(ACCEPT - (9 + i)), 0));
+        }
+        program.push_back(BPF_STMT(BPF_RET | BPF_K, 0));
+        program.push_back(BPF_STMT(BPF_RET | BPF_K, 0xFFFF));
+
+        struct sock_fprog fprog{};
+        fprog.len = static_cast<uint16_t>(program.size());
+        fprog.filter = program.data();
+        if (0 > ::setsockopt(m_socket, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(fprog))) {
+            std::cerr << "[NCOMPacketCapture] Error while attaching filter: " << errno << std::endl;
+            return;
+        }
+    }
+
+    {
+        const int VERSION{TPACKET_V3};
+        if (0 > ::setsockopt(m_socket, SOL_PACKET, PACKET_VERSION, &VERSION, sizeof(VERSION))) {
+            std::cerr << "[NCOMPacketCapture] TPACKET_V3 is not supported: " << errno << std::endl;
+            return;
+        }
+
+        // Blocks are handed over when full or after the retire timeout; many
+        // datagrams per block amortize the wake-ups.
+        m_blockSize = 1 << 18;
+        m_numberOfBlocks = 64;
+        struct tpacket_req3 req{};
+        req.tp_block_size = m_blockSize;
+        req.tp_block_nr = m_numberOfBlocks;
+        req.tp_frame_size = 1 << 11;
+        req.tp_frame_nr = (req.tp_block_size * req.tp_block_nr) / req.tp_frame_size;
+        req.tp_retire_blk_tov = 10;
+        req.tp_feature_req_word = TP_FT_REQ_FILL_RXHASH;
+        if (0 > ::setsockopt(m_socket, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req))) {
+            std::cerr << "[NCOMPacketCapture] Error while setting up the receive ring: " << errno << std::endl;
+            return;
+        }
+
+        m_ringSize = static_cast<std::size_t>(m_blockSize) * m_numberOfBlocks;
+        void *ring = ::mmap(nullptr, m_ringSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED, m_socket, 0);
+        if (MAP_FAILED == ring) {
+            // MAP_LOCKED may fail due to RLIMIT_MEMLOCK; retry without.
+            ring = ::mmap(nullptr, m_ringSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_socket, 0);
+        }
+        if (MAP_FAILED == ring) {
+            std::cerr << "[NCOMPacketCapture] Error while mapping the receive ring: " << errno << std::endl;
+            m_ringSize = 0;
+            return;
+        }
+        m_ring = static_cast<char *>(ring);
+    }
+
+    {
+        struct sockaddr_ll address{};
+        address.sll_family = AF_PACKET;
+        address.sll_protocol = htons(ETH_P_IP);
+        address.sll_ifindex = static_cast<int>(INTERFACE);
+        if (0 > ::bind(m_socket, reinterpret_cast<struct sockaddr *>(&address), sizeof(address))) {
+            std::cerr << "[NCOMPacketCapture] Error while binding to " << interfaceName << ": " << errno << std::endl;
+            return;
+        }
+    }
+
+    m_stopFD = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (0 <= m_stopFD) {
+        m_valid = true;
+        m_readFromRingThreadRunning.store(true);
+        m_readFromRingThread = std::thread(&NCOMPacketCapture::readFromRing, this);
+    }
+}
+
+NCOMPacketCapture::~NCOMPacketCapture() noexcept {
+    m_readFromRingThreadRunning.store(false);
+    if (0 <= m_stopFD) {
+        ::eventfd_write(m_stopFD, 1);
+    }
+    try {
+        if (m_readFromRingThread.joinable()) {
+            m_readFromRingThread.join();
+        }
+    } catch (...) {}
+
+    if (nullptr != m_ring) {
+        ::munmap(m_ring, m_ringSize);
+    }
+    if (0 <= m_socket) {
+        ::close(m_socket);
+    }
+    if (0 <= m_stopFD) {
+        ::close(m_stopFD);
+    }
+}
+
+bool NCOMPacketCapture::isValid() const noexcept {
+    return m_valid;
+}
+
+bool NCOMPacketCapture::isRunning() const noexcept {
+    return m_readFromRingThreadRunning.load();
+}
+
+void NCOMPacketCapture::readFromRing() noexcept {
+    std::array<struct pollfd, 2> fds{};
+    fds[0].fd = m_socket;
+    fds[0].events = POLLIN | POLLERR;
+    fds[1].fd = m_stopFD;
+    fds[1].events = POLLIN;
+
+    uint32_t currentBlock{0};
+    while (m_readFromRingThreadRunning.load()) {
+        struct tpacket_block_desc *block = reinterpret_cast<struct tpacket_block_desc *>(m_ring + static_cast<std::size_t>(currentBlock) * m_blockSize);
+        if (0 == (__atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER)) {
+            if ( (0 > ::poll(fds.data(), fds.size(), -1)) && (EINTR != errno) ) {
+                std::cerr << "[NCOMPacketCapture] Error while waiting for data: " << errno << std::endl;
+                break;
+            }
+            continue;
+        }
+
+        processBlock(reinterpret_cast<const char *>(block));
+
+        // Return the block to the kernel.
+        __atomic_store_n(&block->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+        currentBlock = (currentBlock + 1) % m_numberOfBlocks;
+    }
+    m_readFromRingThreadRunning.store(false);
+}
+
+void NCOMPacketCapture::processBlock(const char *block) noexcept {
+    const struct tpacket_block_desc *desc = reinterpret_cast<const struct tpacket_block_desc *>(block);
+    const uint32_t NUMBER_OF_PACKETS{desc->hdr.bh1.num_pkts};
+    const char *frame = block + desc->hdr.bh1.offset_to_first_pkt;
+
+    for (uint32_t i{0}; i < NUMBER_OF_PACKETS; i++) {
+        const struct tpacket3_hdr *hdr = reinterpret_cast<const struct tpacket3_hdr *>(frame);
+
+        // Frame starts at the IP header for cooked sockets; BPF already
+        // ensured unfragmented UDP to one of our ports.
+        const uint8_t *ip = reinterpret_cast<const uint8_t *>(frame + hdr->tp_net);
+        const std::size_t IP_HEADER_LENGTH{static_cast<std::size_t>(ip[0] & 0x0F) * 4};
+        if ( (4 == (ip[0] >> 4)) && (hdr->tp_snaplen >= IP_HEADER_LENGTH + 8) ) {
+            uint32_t destination{0};
+            std::memcpy(&destination, ip + 16, sizeof(destination));
+            destination = ntohl(destination);
+
+            const uint8_t *udp = ip + IP_HEADER_LENGTH;
+            const uint16_t PORT{static_cast<uint16_t>((udp[2] << 8) | udp[3])};
+            const std::size_t UDP_LENGTH{static_cast<std::size_t>((udp[4] << 8) | udp[5])};
+            const std::size_t CAPTURED{hdr->tp_snaplen - IP_HEADER_LENGTH};
+            const std::size_t LENGTH{((UDP_LENGTH < CAPTURED) ? UDP_LENGTH : CAPTURED) - 8};
+
+            for (std::size_t unit{0}; (8 <= UDP_LENGTH) && (unit < m_ports.size()); unit++) {
+                if ( (m_ports[unit] == PORT) && ((0 == m_addresses[unit]) || (m_addresses[unit] == destination)) ) {
+                    const std::chrono::system_clock::time_point timeStamp{std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                        std::chrono::seconds{hdr->tp_sec} + std::chrono::nanoseconds{hdr->tp_nsec})};
+                    if (nullptr != m_delegate) {
+                        m_delegate(unit, reinterpret_cast<const char *>(udp + 8), LENGTH, timeStamp);
+                    }
+                    if (nullptr != m_relay) {
+                        m_relay->add(reinterpret_cast<const char *>(udp + 8), LENGTH);
+                    }
+                    break;
+                }
+            }
+        }
+        frame += hdr->tp_next_offset;
+    }
+
+    // The datagrams are only valid until the block is returned to the kernel.
+    if (nullptr != m_relay) {
+        m_relay->flush();
+    }
+}
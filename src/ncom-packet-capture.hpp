@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NCOM_PACKET_CAPTURE
+#define NCOM_PACKET_CAPTURE
+
+#include "ncom-udp-receiver.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Captures NCOM datagrams for one or more units from a network interface
+ * (e.g., a mirrored switch port) using an AF_PACKET socket with a memory
+ * mapped TPACKET_V3 ring. A BPF filter lets only the units' UDP ports pass
+ * and the delegate receives pointers into the ring, i.e., without copying.
+ * This requires CAP_NET_RAW.
+ *
+ * Optionally, all captured datagrams are forwarded from the ring through an
+ * NCOMRelay once per block after they were handed to the delegate.
+ */
+class NCOMPacketCapture {
+   private:
+    NCOMPacketCapture(const NCOMPacketCapture &) = delete;
+    NCOMPacketCapture(NCOMPacketCapture &&)      = delete;
+    NCOMPacketCapture &operator=(const NCOMPacketCapture &) = delete;
+    NCOMPacketCapture &operator=(NCOMPacketCapture &&) = delete;
+
+   public:
+    /**
+     * Constructor.
+     *
+     * @param interfaceName Network interface to capture from (e.g., lo or eth0).
+     * @param units List of units; datagrams are matched by UDP destination port
+     *              and, unless 0.0.0.0, destination address.
+     * @param delegate Functional to handle captured datagrams; the time stamp is
+     *                 the kernel's capture time stamp of the frame.
+     * @param relay Relay to forward all captured datagrams to; may be nullptr.
+     */
+    NCOMPacketCapture(const std::string &interfaceName, const std::vector<NCOMUDPReceiver::Unit> &units, NCOMUDPReceiver::Delegate delegate, NCOMRelay *relay = nullptr) noexcept;
+    ~NCOMPacketCapture() noexcept;
+
+    /**
+     * @return true if the capture ring could be set up.
+     */
+    bool isValid() const noexcept;
+
+    /**
+     * @return true while reading from the capture ring.
+     */
+    bool isRunning() const noexcept;
+
+   private:
+    void readFromRing() noexcept;
+    void processBlock(const char *block) noexcept;
+
+   private:
+    NCOMUDPReceiver::Delegate m_delegate{};
+    NCOMRelay *m_relay{nullptr};
+    std::vector<uint16_t> m_ports{};
+    std::vector<uint32_t> m_addresses{};
+
+    int32_t m_socket{-1};
+    int32_t m_stopFD{-1};
+    char *m_ring{nullptr};
+    std::size_t m_ringSize{0};
+    uint32_t m_blockSize{0};
+    uint32_t m_numberOfBlocks{0};
+
+    bool m_valid{false};
+    std::atomic<bool> m_readFromRingThreadRunning{false};
+    std::thread m_readFromRingThread{};
+};
+
+#endif
@@ -0,0 +1,372 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ncom-recorder.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+constexpr std::size_t NCOMRecorder::MAX_PACKET;
+constexpr uint32_t NCOMRecorder::RING;
+constexpr uint64_t NCOMRecorder::WINDOW;
+
+namespace {
+// File layout in host byte order: A header followed by the records, each
+// of which is a RecordHeader, the packet padded to a multiple of 8 bytes,
+// and a RecordTrailer.
+const char FILE_MAGIC[8]{'N', 'C', 'O', 'M', 'R', 'E', 'C', '1'};
+const uint32_t FILE_VERSION{1};
+const uint64_t FILE_HEADER{64};
+const uint32_t RECORD_MAGIC{0x4d4f434e};
+const uint32_t TRAILER_MAGIC{0x444e454e};
+
+class FileHeader {
+   public:
+    char magic[8];
+    uint32_t version;
+    // Incremented by every recorder opening the file.
+    uint32_t generation;
+};
+
+class RecordHeader {
+   public:
+    uint32_t magic;
+    uint32_t length;
+    uint32_t senderStamp;
+    uint32_t generation;
+    int64_t received;
+};
+
+class RecordTrailer {
+   public:
+    // CRC-32 of RecordHeader and packet.
+    uint32_t crc;
+    uint32_t magic;
+};
+
+static_assert(24 == sizeof(RecordHeader), "RecordHeader must not contain padding.");
+static_assert(8 == sizeof(RecordTrailer), "RecordTrailer must not contain padding.");
+
+uint64_t recordSize(uint64_t length) noexcept {
+    return sizeof(RecordHeader) + ((length + 7) & ~static_cast<uint64_t>(7)) + sizeof(RecordTrailer);
+}
+
+uint32_t crc32(uint32_t crc, const char *data, std::size_t length) noexcept {
+    static const std::array<uint32_t, 256> TABLE{[]() {
+        std::array<uint32_t, 256> table{};
+        for (uint32_t i{0}; i < 256; i++) {
+            uint32_t c{i};
+            for (uint32_t k{0}; k < 8; k++) {
+                c = (c & 1) ? (0xedb88320 ^ (c >> 1)) : (c >> 1);
+            }
+            table[i] = c;
+        }
+        return table;
+    }()};
+    crc = ~crc;
+    for (std::size_t i{0}; i < length; i++) {
+        crc = TABLE[(crc ^ static_cast<uint8_t>(data[i])) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// Calls the delegate for each valid record and returns the offset after the
+// last one. Records end at the first one that is incomplete, does not match
+// its trailer, or was written by an earlier generation than its predecessor.
+uint64_t scan(int32_t fd, uint64_t size, const std::function<void(const RecordHeader &, const char *)> &delegate) noexcept {
+    const uint64_t CHUNK{1024 * 1024};
+    std::vector<char> buffer;
+    uint64_t bufferOffset{0};
+    try {
+        buffer.resize(CHUNK + recordSize(NCOMRecorder::MAX_PACKET));
+    } catch (...) {
+        return FILE_HEADER;
+    }
+
+    uint64_t offset{FILE_HEADER};
+    uint64_t available{0};
+    uint32_t generation{0};
+    while (true) {
+        const uint64_t MAX_RECORD{recordSize(NCOMRecorder::MAX_PACKET)};
+        if (offset + MAX_RECORD > bufferOffset + available) {
+            // Refill from the current record on.
+            bufferOffset = offset;
+            available = 0;
+            const uint64_t WANTED{std::min<uint64_t>(buffer.size(), (size > offset) ? size - offset : 0)};
+            while (available < WANTED) {
+                const ssize_t READ{::pread(fd, buffer.data() + available, WANTED - available, static_cast<off_t>(offset + available))};
+                if ( (0 > READ) && (EINTR == errno) ) {
+                    continue;
+                }
+                if (0 >= READ) {
+                    break;
+                }
+                available += static_cast<uint64_t>(READ);
+            }
+        }
+        const uint64_t POSITION{offset - bufferOffset};
+        if (POSITION + sizeof(RecordHeader) > available) {
+            return offset;
+        }
+        RecordHeader header;
+        std::memcpy(&header, buffer.data() + POSITION, sizeof(header));
+        if ( (RECORD_MAGIC != header.magic) || (NCOMRecorder::MAX_PACKET < header.length) || (generation > header.generation)
+             || (POSITION + recordSize(header.length) > available) ) {
+            return offset;
+        }
+        RecordTrailer trailer;
+        std::memcpy(&trailer, buffer.data() + POSITION + recordSize(header.length) - sizeof(trailer), sizeof(trailer));
+        if ( (TRAILER_MAGIC != trailer.magic)
+             || (trailer.crc != crc32(0, buffer.data() + POSITION, sizeof(RecordHeader) + header.length)) ) {
+            return offset;
+        }
+        delegate(header, buffer.data() + POSITION + sizeof(RecordHeader));
+        generation = header.generation;
+        offset += recordSize(header.length);
+    }
+}
+
+// Reads the header of an existing recording.
+bool readHeader(int32_t fd, FileHeader &header) noexcept {
+    return (sizeof(header) == ::pread(fd, &header, sizeof(header), 0))
+        && (0 == std::memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC))) && (FILE_VERSION == header.version);
+}
+}
+
+NCOMRecorder::NCOMRecorder(const std::string &path, uint64_t size, std::chrono::milliseconds syncInterval) noexcept
+    : m_syncInterval(syncInterval)
+    , m_ring(RING, OverflowPolicy::DROP_NEWEST) {
+    m_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (0 > m_fd) {
+        std::cerr << "[NCOMRecorder] Error while opening '" << path << "': " << errno << std::endl;
+        return;
+    }
+    struct stat info{};
+    if (0 != ::fstat(m_fd, &info)) {
+        std::cerr << "[NCOMRecorder] Error while accessing '" << path << "': " << errno << std::endl;
+        return;
+    }
+
+    // Continue after the valid records of a previous recording, but never
+    // overwrite any other file.
+    FileHeader header{};
+    m_offset = FILE_HEADER;
+    if (0 < info.st_size) {
+        if (!readHeader(m_fd, header)) {
+            std::cerr << "[NCOMRecorder] '" << path << "' is no NCOM recording." << std::endl;
+            return;
+        }
+        m_offset = scan(m_fd, static_cast<uint64_t>(info.st_size), [](const RecordHeader &, const char *) {});
+    }
+    m_generation = header.generation + 1;
+    m_size = std::max(size, static_cast<uint64_t>(info.st_size));
+    m_synced = m_offset;
+    if (m_offset + recordSize(MAX_PACKET) > m_size) {
+        std::cerr << "[NCOMRecorder] '" << path << "' is full." << std::endl;
+        return;
+    }
+
+    std::memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+    header.version = FILE_VERSION;
+    header.generation = m_generation;
+    if ( (sizeof(header) != ::pwrite(m_fd, &header, sizeof(header), 0)) || (0 != ::fdatasync(m_fd)) ) {
+        std::cerr << "[NCOMRecorder] Error while writing to '" << path << "': " << errno << std::endl;
+        return;
+    }
+    // Allocate all blocks now rather than while recording.
+    const int32_t ALLOCATED{::posix_fallocate(m_fd, 0, static_cast<off_t>(m_size))};
+    if (0 != ALLOCATED) {
+        std::cerr << "[NCOMRecorder] Error while preallocating " << m_size << " bytes for '" << path << "': " << ALLOCATED << std::endl;
+        return;
+    }
+    if (!map(m_offset)) {
+        return;
+    }
+
+    m_running.store(true);
+    try {
+        m_recorder = std::thread(&NCOMRecorder::record, this);
+    } catch (...) {
+        m_running.store(false);
+    }
+}
+
+NCOMRecorder::~NCOMRecorder() noexcept {
+    m_running.store(false);
+    m_ring.wakeUp();
+    if (m_recorder.joinable()) {
+        m_recorder.join();
+    }
+    unmap();
+    if (0 <= m_fd) {
+        ::close(m_fd);
+    }
+}
+
+bool NCOMRecorder::isValid() const noexcept {
+    return m_running.load();
+}
+
+bool NCOMRecorder::add(const char *data, std::size_t length, uint32_t senderStamp, const std::chrono::system_clock::time_point &tp) noexcept {
+    if (!m_running.load(std::memory_order_relaxed) || (MAX_PACKET < length)) {
+        m_dropped++;
+        return false;
+    }
+    Packet packet{};
+    packet.received = std::chrono::duration_cast<std::chrono::microseconds>(tp.time_since_epoch()).count();
+    packet.senderStamp = senderStamp;
+    packet.length = static_cast<uint32_t>(length);
+    std::memcpy(packet.data.data(), data, length);
+    return m_ring.push(packet);
+}
+
+uint64_t NCOMRecorder::recorded() const noexcept {
+    return m_recorded.load(std::memory_order_relaxed);
+}
+
+uint64_t NCOMRecorder::dropped() const noexcept {
+    return m_dropped.load(std::memory_order_relaxed) + m_ring.dropped();
+}
+
+void NCOMRecorder::record() noexcept {
+    auto lastSync{std::chrono::steady_clock::now()};
+    Packet packet{};
+    while (m_running.load()) {
+        if (m_ring.waitAndPop(packet, m_syncInterval)) {
+            do {
+                append(packet);
+            } while (m_ring.pop(packet));
+        }
+        const auto NOW{std::chrono::steady_clock::now()};
+        if (NOW - lastSync >= m_syncInterval) {
+            sync();
+            lastSync = NOW;
+        }
+    }
+    // Record what is left before stopping.
+    while (m_ring.pop(packet)) {
+        append(packet);
+    }
+    sync();
+}
+
+bool NCOMRecorder::append(const Packet &packet) noexcept {
+    const uint64_t SIZE{recordSize(packet.length)};
+    if (m_full || (m_offset + SIZE > m_size)) {
+        if (!m_full) {
+            std::cerr << "[NCOMRecorder] File is full after " << m_recorded.load() << " packets." << std::endl;
+        }
+        m_full = true;
+        m_dropped++;
+        return false;
+    }
+    if (m_offset + SIZE > m_windowOffset + m_windowSize) {
+        sync();
+        unmap();
+        if (!map(m_offset)) {
+            m_full = true;
+            m_dropped++;
+            return false;
+        }
+    }
+
+    RecordHeader header;
+    header.magic = RECORD_MAGIC;
+    header.length = packet.length;
+    header.senderStamp = packet.senderStamp;
+    header.generation = m_generation;
+    header.received = packet.received;
+    char *record{m_window + (m_offset - m_windowOffset)};
+    std::memcpy(record, &header, sizeof(header));
+    std::memcpy(record + sizeof(header), packet.data.data(), packet.length);
+    const uint64_t TRAILER{SIZE - sizeof(RecordTrailer)};
+    std::memset(record + sizeof(header) + packet.length, 0, TRAILER - sizeof(header) - packet.length);
+    RecordTrailer trailer;
+    trailer.crc = crc32(0, record, sizeof(header) + packet.length);
+    trailer.magic = TRAILER_MAGIC;
+    std::memcpy(record + TRAILER, &trailer, sizeof(trailer));
+
+    m_offset += SIZE;
+    m_recorded++;
+    return true;
+}
+
+bool NCOMRecorder::map(uint64_t offset) noexcept {
+    // Mapping a window at a time keeps the address space small on 32-bit systems.
+    const uint64_t PAGE{static_cast<uint64_t>(::sysconf(_SC_PAGESIZE))};
+    const uint64_t WINDOW_OFFSET{offset - (offset % PAGE)};
+    const uint64_t WINDOW_SIZE{std::min(WINDOW, m_size - WINDOW_OFFSET)};
+    void *window{::mmap(nullptr, WINDOW_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, static_cast<off_t>(WINDOW_OFFSET))};
+    if (MAP_FAILED == window) {
+        std::cerr << "[NCOMRecorder] Error while mapping " << WINDOW_SIZE << " bytes at " << WINDOW_OFFSET << ": " << errno << std::endl;
+        return false;
+    }
+    m_window = static_cast<char *>(window);
+    m_windowOffset = WINDOW_OFFSET;
+    m_windowSize = WINDOW_SIZE;
+    return true;
+}
+
+void NCOMRecorder::sync() noexcept {
+    if ( (nullptr == m_window) || (m_synced >= m_offset) ) {
+        return;
+    }
+    const uint64_t PAGE{static_cast<uint64_t>(::sysconf(_SC_PAGESIZE))};
+    const uint64_t FROM{std::max(m_synced, m_windowOffset)};
+    const uint64_t START{FROM - (FROM % PAGE)};
+    if (0 != ::msync(m_window + (START - m_windowOffset), m_offset - START, MS_SYNC)) {
+        std::cerr << "[NCOMRecorder] Error while syncing: " << errno << std::endl;
+        return;
+    }
+    m_synced = m_offset;
+}
+
+void NCOMRecorder::unmap() noexcept {
+    if (nullptr != m_window) {
+        ::munmap(m_window, m_windowSize);
+        m_window = nullptr;
+        m_windowSize = 0;
+    }
+}
+
+uint64_t NCOMRecorder::replay(const std::string &path, std::function<void(uint32_t, const char *, std::size_t, const std::chrono::system_clock::time_point &)> delegate) noexcept {
+    const int32_t FD{::open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+    if (0 > FD) {
+        return 0;
+    }
+    uint64_t records{0};
+    struct stat info{};
+    FileHeader header{};
+    if ( (0 == ::fstat(FD, &info)) && readHeader(FD, header) ) {
+        scan(FD, static_cast<uint64_t>(info.st_size), [&delegate, &records](const RecordHeader &r, const char *data) {
+            if (delegate) {
+                delegate(r.senderStamp, data, r.length, std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::microseconds(r.received))));
+            }
+            records++;
+        });
+    }
+    ::close(FD);
+    return records;
+}
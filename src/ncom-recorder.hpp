@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NCOM_RECORDER
+#define NCOM_RECORDER
+
+#include "spsc-ring.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+
+/**
+ * Records raw NCOM packets with their time of reception and the sender stamp
+ * of their unit to a preallocated, append-only file. add() only copies the
+ * packet into a ring; a separate thread appends the packets to a memory-mapped
+ * window of the file and msyncs the written part periodically, so that a
+ * stalling storage device never delays decoding. If the ring is full or the
+ * file is exhausted, packets are dropped and counted.
+ *
+ * Every record ends with a trailer holding a CRC-32 of the record, and each
+ * session writing to the file has its own generation number. After a power
+ * loss, the records up to the first one that is incomplete, corrupted, or
+ * from an earlier session are valid; replay() reads them and a new recorder
+ * appends after them.
+ * Not thread-safe: add() must be called from one thread.
+ */
+class NCOMRecorder {
+   private:
+    NCOMRecorder(const NCOMRecorder &) = delete;
+    NCOMRecorder(NCOMRecorder &&)      = delete;
+    NCOMRecorder &operator=(const NCOMRecorder &) = delete;
+    NCOMRecorder &operator=(NCOMRecorder &&) = delete;
+
+   public:
+    /**
+     * Constructor.
+     *
+     * @param path File to record to; recordings in an existing file are kept.
+     * @param size Size to preallocate the file to in bytes.
+     * @param syncInterval Maximum time until recorded packets are synced to storage.
+     */
+    NCOMRecorder(const std::string &path, uint64_t size, std::chrono::milliseconds syncInterval) noexcept;
+    ~NCOMRecorder() noexcept;
+
+    /**
+     * @return true if the file could be prepared and the recording thread started.
+     */
+    bool isValid() const noexcept;
+
+    /**
+     * Queue a packet for recording; never blocks.
+     *
+     * @param data Packet.
+     * @param length Length of the packet.
+     * @param senderStamp Sender stamp of the unit the packet came from.
+     * @param tp Time of reception, e.g., the kernel's time stamp.
+     * @return true if the packet was queued, false if it was dropped.
+     */
+    bool add(const char *data, std::size_t length, uint32_t senderStamp, const std::chrono::system_clock::time_point &tp) noexcept;
+
+    /**
+     * @return Number of packets written to the file.
+     */
+    uint64_t recorded() const noexcept;
+
+    /**
+     * @return Number of packets dropped as the ring was full, the file was
+     *         exhausted, or they were longer than MAX_PACKET.
+     */
+    uint64_t dropped() const noexcept;
+
+    /**
+     * Read the valid records of a file in the order they were recorded.
+     *
+     * @param path File to read.
+     * @param delegate Function to call for each record with sender stamp, data, length, and time of reception.
+     * @return Number of valid records.
+     */
+    static uint64_t replay(const std::string &path, std::function<void(uint32_t, const char *, std::size_t, const std::chrono::system_clock::time_point &)> delegate) noexcept;
+
+   public:
+    static constexpr std::size_t MAX_PACKET{256};
+
+   private:
+    class Packet {
+       public:
+        int64_t received;
+        uint32_t senderStamp;
+        uint32_t length;
+        std::array<char, MAX_PACKET> data;
+    };
+
+    void record() noexcept;
+    bool append(const Packet &packet) noexcept;
+    bool map(uint64_t offset) noexcept;
+    void sync() noexcept;
+    void unmap() noexcept;
+
+   private:
+    static constexpr uint32_t RING{4096};
+    static constexpr uint64_t WINDOW{16 * 1024 * 1024};
+
+    int32_t m_fd{-1};
+    uint64_t m_size{0};
+    uint32_t m_generation{0};
+    std::chrono::milliseconds m_syncInterval;
+
+    // Mapped part of the file, all offsets relative to the file.
+    char *m_window{nullptr};
+    uint64_t m_windowOffset{0};
+    uint64_t m_windowSize{0};
+    uint64_t m_offset{0};
+    uint64_t m_synced{0};
+    bool m_full{false};
+
+    SPSCRing<Packet> m_ring;
+    std::atomic<uint64_t> m_recorded{0};
+    std::atomic<uint64_t> m_dropped{0};
+    std::atomic<bool> m_running{false};
+    std::thread m_recorder{};
+};
+
+#endif
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ncom-relay.hpp"
+#include "split.hpp"
+
+#include "cluon-complete.hpp"
+
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <iostream>
+
+constexpr std::size_t NCOMRelay::BATCH;
+
+NCOMRelay::NCOMRelay(const std::string &destinations) noexcept {
+    try {
+        for (auto entry : split(destinations, ',')) {
+            entry = stringtoolbox::trim(entry);
+            const std::string::size_type COLON{entry.rfind(':')};
+            struct sockaddr_in address{};
+            address.sin_family = AF_INET;
+            if ( (std::string::npos == COLON) || (1 != ::inet_pton(AF_INET, entry.substr(0, COLON).c_str(), &address.sin_addr)) ) {
+                std::cerr << "[NCOMRelay] Malformed destination '" << entry << "', expected ip:port." << std::endl;
+                m_destinations.clear();
+                return;
+            }
+            address.sin_port = htons(static_cast<uint16_t>(std::stoi(entry.substr(COLON + 1))));
+            m_destinations.push_back(address);
+        }
+    } catch (...) {
+        std::cerr << "[NCOMRelay] Malformed list of destinations '" << destinations << "'." << std::endl;
+        m_destinations.clear();
+        return;
+    }
+    if (m_destinations.empty()) {
+        return;
+    }
+
+    // Non-blocking: A full send buffer must never delay receiving.
+    m_socket = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_UDP);
+    if (0 > m_socket) {
+        std::cerr << "[NCOMRelay] Error while creating socket: " << errno << std::endl;
+        return;
+    }
+    // Allow multicast destinations on other subnets.
+    const int TTL{8};
+    ::setsockopt(m_socket, IPPROTO_IP, IP_MULTICAST_TTL, &TTL, sizeof(TTL));
+
+    // One message per datagram and destination; all messages of a datagram
+    // share its iovec.
+    m_iovecs.resize(BATCH);
+    m_headers.resize(BATCH * m_destinations.size());
+    for (std::size_t i{0}; i < m_headers.size(); i++) {
+        struct msghdr &hdr = m_headers[i].msg_hdr;
+        hdr.msg_name = &m_destinations[i % m_destinations.size()];
+        hdr.msg_namelen = sizeof(struct sockaddr_in);
+        hdr.msg_iov = &m_iovecs[i / m_destinations.size()];
+        hdr.msg_iovlen = 1;
+    }
+}
+
+NCOMRelay::~NCOMRelay() noexcept {
+    if (0 <= m_socket) {
+        ::close(m_socket);
+    }
+}
+
+bool NCOMRelay::isValid() const noexcept {
+    return (0 <= m_socket);
+}
+
+void NCOMRelay::add(const char *data, std::size_t length) noexcept {
+    if (0 > m_socket) {
+        return;
+    }
+    m_iovecs[m_queued].iov_base = const_cast<char *>(data);
+    m_iovecs[m_queued].iov_len = length;
+    m_queued++;
+    m_pending += m_destinations.size();
+    if (BATCH == m_queued) {
+        flush();
+    }
+}
+
+void NCOMRelay::flush() noexcept {
+    std::size_t sent{0};
+    while (sent < m_pending) {
+        const int RETVAL{::sendmmsg(m_socket, &m_headers[sent], static_cast<unsigned int>(m_pending - sent), MSG_DONTWAIT)};
+        if (0 > RETVAL) {
+            if (EINTR == errno) {
+                continue;
+            }
+            if ( (EAGAIN == errno) || (EWOULDBLOCK == errno) ) {
+                // Send buffer is full: Drop the rest instead of waiting.
+                m_dropped.fetch_add(m_pending - sent, std::memory_order_relaxed);
+                break;
+            }
+            // Skip the datagram that could not be sent (e.g., to an
+            // unreachable destination) and try the remaining ones.
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            sent++;
+            continue;
+        }
+        sent += static_cast<std::size_t>(RETVAL);
+        m_forwarded.fetch_add(static_cast<uint64_t>(RETVAL), std::memory_order_relaxed);
+    }
+    m_queued = 0;
+    m_pending = 0;
+}
+
+uint64_t NCOMRelay::forwarded() const noexcept {
+    return m_forwarded.load(std::memory_order_relaxed);
+}
+
+uint64_t NCOMRelay::dropped() const noexcept {
+    return m_dropped.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NCOM_RELAY
+#define NCOM_RELAY
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <string>
+#include <vector>
+
+/**
+ * Forwards raw datagrams to a list of UDP destinations. Datagrams are only
+ * referenced, not copied: add() queues the given memory for each destination
+ * and flush() sends everything queued with one non-blocking sendmmsg(); the
+ * caller must keep the memory valid until flush() returns. Datagrams that
+ * cannot be sent immediately are dropped and counted instead of delaying the
+ * caller. Not thread-safe: add() and flush() must be called from one thread.
+ */
+class NCOMRelay {
+   private:
+    NCOMRelay(const NCOMRelay &) = delete;
+    NCOMRelay(NCOMRelay &&)      = delete;
+    NCOMRelay &operator=(const NCOMRelay &) = delete;
+    NCOMRelay &operator=(NCOMRelay &&) = delete;
+
+   public:
+    /**
+     * Constructor.
+     *
+     * @param destinations Comma-separated list of ip:port destinations;
+     *                     multicast groups are sent to with a TTL of 8.
+     */
+    explicit NCOMRelay(const std::string &destinations) noexcept;
+    ~NCOMRelay() noexcept;
+
+    /**
+     * @return true if all destinations could be parsed and the socket was created.
+     */
+    bool isValid() const noexcept;
+
+    /**
+     * Queue a datagram for all destinations; flushes when the batch is full.
+     *
+     * @param data Datagram, to be valid until the next flush().
+     * @param length Length of the datagram.
+     */
+    void add(const char *data, std::size_t length) noexcept;
+
+    /**
+     * Send all queued datagrams.
+     */
+    void flush() noexcept;
+
+    /**
+     * @return Number of datagrams sent (counting each destination).
+     */
+    uint64_t forwarded() const noexcept;
+
+    /**
+     * @return Number of datagrams dropped as they could not be sent immediately.
+     */
+    uint64_t dropped() const noexcept;
+
+   private:
+    static constexpr std::size_t BATCH{64};
+
+    int32_t m_socket{-1};
+    std::vector<struct sockaddr_in> m_destinations{};
+    std::vector<struct iovec> m_iovecs{};
+    std::vector<struct mmsghdr> m_headers{};
+    std::size_t m_queued{0};
+    std::size_t m_pending{0};
+
+    std::atomic<uint64_t> m_forwarded{0};
+    std::atomic<uint64_t> m_dropped{0};
+};
+
+#endif
@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ncom-serial-receiver.hpp"
+
+#include <fcntl.h>
+#include <linux/serial.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <array>
+#include <iostream>
+
+namespace {
+speed_t speedOf(uint32_t baud) noexcept {
+    switch (baud) {
+        case 9600: return B9600;
+        case 19200: return B19200;
+        case 38400: return B38400;
+        case 57600: return B57600;
+        case 115200: return B115200;
+        case 230400: return B230400;
+        case 460800: return B460800;
+        case 921600: return B921600;
+        default: return B0;
+    }
+}
+}
+
+NCOMSerialReceiver::NCOMSerialReceiver(const std::string &device, uint32_t baud, NCOMUDPReceiver::Delegate delegate) noexcept
+    : m_delegate(std::move(delegate)) {
+    const speed_t SPEED{speedOf(baud)};
+    if (B0 == SPEED) {
+        std::cerr << "[NCOMSerialReceiver] Unsupported baud rate " << baud << std::endl;
+        return;
+    }
+
+    m_fd = ::open(device.c_str(), O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (0 > m_fd) {
+        std::cerr << "[NCOMSerialReceiver] Error while opening " << device << ": " << errno << std::endl;
+        return;
+    }
+
+    // Raw 8N1 without flow control; read() returns as soon as one byte is
+    // available (VMIN = 1, VTIME = 0) so that packets are not delayed by an
+    // inter-byte timer. Packet boundaries are found by the framer instead.
+    struct termios tty{};
+    if (0 > ::tcgetattr(m_fd, &tty)) {
+        std::cerr << "[NCOMSerialReceiver] " << device << " is not a terminal: " << errno << std::endl;
+        return;
+    }
+    ::cfmakeraw(&tty);
+    tty.c_cflag |= (CLOCAL | CREAD);
+    tty.c_cflag &= ~static_cast<tcflag_t>(CSTOPB | CRTSCTS);
+    tty.c_cc[VMIN] = 1;
+    tty.c_cc[VTIME] = 0;
+    ::cfsetispeed(&tty, SPEED);
+    ::cfsetospeed(&tty, SPEED);
+    if (0 > ::tcsetattr(m_fd, TCSANOW, &tty)) {
+        std::cerr << "[NCOMSerialReceiver] Error while configuring " << device << ": " << errno << std::endl;
+        return;
+    }
+    ::tcflush(m_fd, TCIFLUSH);
+
+#ifdef ASYNC_LOW_LATENCY
+    // Ask UART drivers to push received bytes immediately; not supported by
+    // all drivers (e.g., pseudo terminals), which is fine.
+    struct serial_struct serial{};
+    if (0 == ::ioctl(m_fd, TIOCGSERIAL, &serial)) {
+        serial.flags |= ASYNC_LOW_LATENCY;
+        ::ioctl(m_fd, TIOCSSERIAL, &serial);
+    }
+#endif
+
+    m_stopFD = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (0 <= m_stopFD) {
+        m_valid = true;
+        m_readFromDeviceThreadRunning.store(true);
+        m_readFromDeviceThread = std::thread(&NCOMSerialReceiver::readFromDevice, this);
+    }
+}
+
+NCOMSerialReceiver::~NCOMSerialReceiver() noexcept {
+    m_readFromDeviceThreadRunning.store(false);
+    if (0 <= m_stopFD) {
+        ::eventfd_write(m_stopFD, 1);
+    }
+    try {
+        if (m_readFromDeviceThread.joinable()) {
+            m_readFromDeviceThread.join();
+        }
+    } catch (...) {}
+
+    if (0 <= m_fd) {
+        ::close(m_fd);
+    }
+    if (0 <= m_stopFD) {
+        ::close(m_stopFD);
+    }
+}
+
+bool NCOMSerialReceiver::isValid() const noexcept {
+    return m_valid;
+}
+
+bool NCOMSerialReceiver::isRunning() const noexcept {
+    return m_readFromDeviceThreadRunning.load();
+}
+
+uint64_t NCOMSerialReceiver::discardedBytes() const noexcept {
+    return m_discardedBytes.load(std::memory_order_relaxed);
+}
+
+void NCOMSerialReceiver::readFromDevice() noexcept {
+    std::chrono::system_clock::time_point timeStamp{};
+    NCOMFramer framer([this, &timeStamp](const char *data, std::size_t length) {
+        if (nullptr != m_delegate) {
+            m_delegate(0, data, length, timeStamp);
+        }
+    });
+
+    std::array<struct pollfd, 2> fds{};
+    fds[0].fd = m_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = m_stopFD;
+    fds[1].events = POLLIN;
+
+    std::array<char, 4096> buffer{};
+    while (m_readFromDeviceThreadRunning.load()) {
+        if (0 > ::poll(fds.data(), fds.size(), -1)) {
+            if (EINTR == errno) {
+                continue;
+            }
+            std::cerr << "[NCOMSerialReceiver] Error while waiting for data: " << errno << std::endl;
+            break;
+        }
+        if (0 != (fds[1].revents & POLLIN)) {
+            break;
+        }
+        if (0 != (fds[0].revents & (POLLERR | POLLHUP | POLLNVAL))) {
+            std::cerr << "[NCOMSerialReceiver] Serial device disconnected." << std::endl;
+            break;
+        }
+        if (0 == (fds[0].revents & POLLIN)) {
+            continue;
+        }
+
+        const ssize_t N{::read(m_fd, buffer.data(), buffer.size())};
+        if (0 > N) {
+            if ( (EINTR == errno) || (EAGAIN == errno) ) {
+                continue;
+            }
+            std::cerr << "[NCOMSerialReceiver] Error while reading: " << errno << std::endl;
+            break;
+        }
+        timeStamp = std::chrono::system_clock::now();
+        framer.feed(buffer.data(), static_cast<std::size_t>(N));
+        m_discardedBytes.store(framer.discardedBytes(), std::memory_order_relaxed);
+    }
+    m_readFromDeviceThreadRunning.store(false);
+}
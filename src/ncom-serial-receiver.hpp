@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NCOM_SERIAL_RECEIVER
+#define NCOM_SERIAL_RECEIVER
+
+#include "ncom-framer.hpp"
+#include "ncom-udp-receiver.hpp"
+
+#include <cstdint>
+#include <atomic>
+#include <string>
+#include <thread>
+
+/**
+ * Receives NCOM packets from an OxTS unit connected via RS-232. The port is
+ * set to raw mode returning from read() as soon as any byte is available and,
+ * where the driver supports it, to low latency (no FIFO/tty buffer delays).
+ */
+class NCOMSerialReceiver {
+   private:
+    NCOMSerialReceiver(const NCOMSerialReceiver &) = delete;
+    NCOMSerialReceiver(NCOMSerialReceiver &&)      = delete;
+    NCOMSerialReceiver &operator=(const NCOMSerialReceiver &) = delete;
+    NCOMSerialReceiver &operator=(NCOMSerialReceiver &&) = delete;
+
+   public:
+    /**
+     * Constructor.
+     *
+     * @param device Serial device (e.g., /dev/ttyUSB0).
+     * @param baud Baud rate (e.g., 115200 or 230400).
+     * @param delegate Functional to handle received packets; the unit is always
+     *                 0 and the time stamp is when the packet's last byte was read.
+     */
+    NCOMSerialReceiver(const std::string &device, uint32_t baud, NCOMUDPReceiver::Delegate delegate) noexcept;
+    ~NCOMSerialReceiver() noexcept;
+
+    /**
+     * @return true if the device could be opened and configured.
+     */
+    bool isValid() const noexcept;
+
+    /**
+     * @return true while reading from the device.
+     */
+    bool isRunning() const noexcept;
+
+    /**
+     * @return Number of bytes skipped while searching for packet boundaries.
+     */
+    uint64_t discardedBytes() const noexcept;
+
+   private:
+    void readFromDevice() noexcept;
+
+   private:
+    NCOMUDPReceiver::Delegate m_delegate{};
+    int32_t m_fd{-1};
+    int32_t m_stopFD{-1};
+    std::atomic<uint64_t> m_discardedBytes{0};
+
+    bool m_valid{false};
+    std::atomic<bool> m_readFromDeviceThreadRunning{false};
+    std::thread m_readFromDeviceThread{};
+};
+
+#endif
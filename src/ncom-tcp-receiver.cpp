@@ -0,0 +1,224 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ncom-tcp-receiver.hpp"
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <array>
+#include <iostream>
+#include <vector>
+
+NCOMTCPReceiver::NCOMTCPReceiver(const std::string &host, uint16_t port, NCOMUDPReceiver::Delegate delegate, std::chrono::milliseconds maxBackoff) noexcept
+    : m_delegate(std::move(delegate))
+    , m_host(host)
+    , m_port(port)
+    , m_maxBackoff(maxBackoff)
+    , m_framer([this](const char *data, std::size_t length) {
+        m_packets++;
+        if (nullptr != m_delegate) {
+            m_delegate(0, data, length, m_timeStamp);
+        }
+    }) {
+    m_stopFD = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if ( (0 <= m_stopFD) && (0 != m_port) && !m_host.empty() ) {
+        m_valid = true;
+        m_receiveThreadRunning.store(true);
+        m_receiveThread = std::thread(&NCOMTCPReceiver::receive, this);
+    }
+}
+
+NCOMTCPReceiver::~NCOMTCPReceiver() noexcept {
+    m_receiveThreadRunning.store(false);
+    if (0 <= m_stopFD) {
+        ::eventfd_write(m_stopFD, 1);
+    }
+    try {
+        if (m_receiveThread.joinable()) {
+            m_receiveThread.join();
+        }
+    } catch (...) {}
+
+    if (0 <= m_stopFD) {
+        ::close(m_stopFD);
+    }
+}
+
+bool NCOMTCPReceiver::isValid() const noexcept {
+    return m_valid;
+}
+
+bool NCOMTCPReceiver::isRunning() const noexcept {
+    return m_receiveThreadRunning.load();
+}
+
+bool NCOMTCPReceiver::isConnected() const noexcept {
+    return m_isConnected.load();
+}
+
+uint32_t NCOMTCPReceiver::connections() const noexcept {
+    return m_connections.load();
+}
+
+uint64_t NCOMTCPReceiver::discardedBytes() const noexcept {
+    return m_discardedBytes.load(std::memory_order_relaxed);
+}
+
+bool NCOMTCPReceiver::waitForStop(std::chrono::milliseconds timeout) noexcept {
+    struct pollfd fd{};
+    fd.fd = m_stopFD;
+    fd.events = POLLIN;
+    return (0 < ::poll(&fd, 1, static_cast<int>(timeout.count()))) || !m_receiveThreadRunning.load();
+}
+
+int32_t NCOMTCPReceiver::connect() noexcept {
+    struct addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo *result{nullptr};
+    if (0 != ::getaddrinfo(m_host.c_str(), std::to_string(m_port).c_str(), &hints, &result)) {
+        return -1;
+    }
+
+    int32_t s{-1};
+    for (struct addrinfo *ai = result; (nullptr != ai) && (0 > s); ai = ai->ai_next) {
+        s = ::socket(ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ai->ai_protocol);
+        if (0 > s) {
+            continue;
+        }
+        int32_t retVal{::connect(s, ai->ai_addr, ai->ai_addrlen)};
+        if ( (0 > retVal) && (EINPROGRESS == errno) ) {
+            // Wait for the connection while staying responsive to stop requests.
+            std::array<struct pollfd, 2> fds{};
+            fds[0].fd = s;
+            fds[0].events = POLLOUT;
+            fds[1].fd = m_stopFD;
+            fds[1].events = POLLIN;
+            if ( (0 < ::poll(fds.data(), fds.size(), 2000)) && (0 != (fds[0].revents & POLLOUT)) ) {
+                int error{0};
+                socklen_t length{sizeof(error)};
+                ::getsockopt(s, SOL_SOCKET, SO_ERROR, &error, &length);
+                retVal = (0 == error) ? 0 : -1;
+            }
+        }
+        if (0 > retVal) {
+            ::close(s);
+            s = -1;
+        }
+    }
+    ::freeaddrinfo(result);
+
+    if (0 <= s) {
+        // Detect a vanished gateway even if no FIN/RST arrives.
+        const int YES{1};
+        const int IDLE{2};
+        const int INTERVAL{1};
+        const int COUNT{3};
+        ::setsockopt(s, SOL_SOCKET, SO_KEEPALIVE, &YES, sizeof(YES));
+        ::setsockopt(s, IPPROTO_TCP, TCP_KEEPIDLE, &IDLE, sizeof(IDLE));
+        ::setsockopt(s, IPPROTO_TCP, TCP_KEEPINTVL, &INTERVAL, sizeof(INTERVAL));
+        ::setsockopt(s, IPPROTO_TCP, TCP_KEEPCNT, &COUNT, sizeof(COUNT));
+    }
+    return s;
+}
+
+void NCOMTCPReceiver::readFromConnection(int32_t s) noexcept {
+    std::array<struct pollfd, 2> fds{};
+    fds[0].fd = s;
+    fds[0].events = POLLIN;
+    fds[1].fd = m_stopFD;
+    fds[1].events = POLLIN;
+
+    // Large reads collect many packets per syscall; packets lying completely
+    // in the buffer are handed over in place.
+    std::vector<char> buffer(64 * 1024);
+    while (m_receiveThreadRunning.load()) {
+        if (0 > ::poll(fds.data(), fds.size(), -1)) {
+            if (EINTR == errno) {
+                continue;
+            }
+            break;
+        }
+        if (0 != (fds[1].revents & POLLIN)) {
+            break;
+        }
+
+        // Drain the socket.
+        ssize_t n{0};
+        do {
+            n = ::recv(s, buffer.data(), buffer.size(), MSG_DONTWAIT);
+            if (0 < n) {
+                m_timeStamp = std::chrono::system_clock::now();
+                m_framer.feed(buffer.data(), static_cast<std::size_t>(n));
+            }
+        } while (static_cast<std::size_t>(n) == buffer.size());
+        m_discardedBytes.store(m_framer.discardedBytes(), std::memory_order_relaxed);
+
+        if ( (0 == n) || ((0 > n) && (EAGAIN != errno) && (EWOULDBLOCK != errno) && (EINTR != errno)) ) {
+            // Connection closed or failed.
+            break;
+        }
+    }
+}
+
+void NCOMTCPReceiver::receive() noexcept {
+    constexpr std::chrono::milliseconds MIN_BACKOFF{100};
+    std::chrono::milliseconds backoff{MIN_BACKOFF};
+    while (m_receiveThreadRunning.load()) {
+        const int32_t s{connect()};
+        if (0 > s) {
+            if (waitForStop(backoff)) {
+                break;
+            }
+            backoff = (backoff * 2 < m_maxBackoff) ? backoff * 2 : m_maxBackoff;
+            continue;
+        }
+
+        m_connections++;
+        m_isConnected.store(true);
+        const uint64_t PACKETS{m_packets};
+        readFromConnection(s);
+        m_isConnected.store(false);
+        ::close(s);
+
+        // A packet cut off by the disconnect must not be combined with the next stream.
+        m_framer.reset();
+        m_discardedBytes.store(m_framer.discardedBytes(), std::memory_order_relaxed);
+        if (!m_receiveThreadRunning.load()) {
+            break;
+        }
+        std::cerr << "[NCOMTCPReceiver] Connection to " << m_host << ":" << m_port << " lost; reconnecting." << std::endl;
+
+        // Only a connection that delivered data counts as established; a peer
+        // closing right after accepting is retried with growing delays, too.
+        if (PACKETS != m_packets) {
+            backoff = MIN_BACKOFF;
+        }
+        if (waitForStop(backoff)) {
+            break;
+        }
+        backoff = (backoff * 2 < m_maxBackoff) ? backoff * 2 : m_maxBackoff;
+    }
+    m_receiveThreadRunning.store(false);
+}
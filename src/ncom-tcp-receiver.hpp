@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NCOM_TCP_RECEIVER
+#define NCOM_TCP_RECEIVER
+
+#include "ncom-framer.hpp"
+#include "ncom-udp-receiver.hpp"
+
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+/**
+ * Receives NCOM packets relayed as a TCP byte stream (e.g., by a gateway).
+ * The connection is re-established with exponential backoff whenever it
+ * cannot be opened or is lost; the backoff starts over only after a
+ * connection delivered at least one complete packet. Data is read in large non-blocking reads
+ * from which packets are framed in place.
+ */
+class NCOMTCPReceiver {
+   private:
+    NCOMTCPReceiver(const NCOMTCPReceiver &) = delete;
+    NCOMTCPReceiver(NCOMTCPReceiver &&)      = delete;
+    NCOMTCPReceiver &operator=(const NCOMTCPReceiver &) = delete;
+    NCOMTCPReceiver &operator=(NCOMTCPReceiver &&) = delete;
+
+   public:
+    /**
+     * Constructor.
+     *
+     * @param host Host name or IPv4 address of the gateway.
+     * @param port TCP port of the gateway.
+     * @param delegate Functional to handle received packets; the unit is always
+     *                 0 and the time stamp is when the packet's last byte was read.
+     * @param maxBackoff Upper limit for the delay between connection attempts.
+     */
+    NCOMTCPReceiver(const std::string &host, uint16_t port, NCOMUDPReceiver::Delegate delegate, std::chrono::milliseconds maxBackoff = std::chrono::milliseconds{5000}) noexcept;
+    ~NCOMTCPReceiver() noexcept;
+
+    /**
+     * @return true if host and port were given and the receiving thread was started.
+     */
+    bool isValid() const noexcept;
+
+    /**
+     * @return true while the receiving thread is running, also when (re)connecting.
+     */
+    bool isRunning() const noexcept;
+
+    /**
+     * @return true if currently connected.
+     */
+    bool isConnected() const noexcept;
+
+    /**
+     * @return Number of successfully established connections.
+     */
+    uint32_t connections() const noexcept;
+
+    /**
+     * @return Number of bytes skipped while searching for packet boundaries.
+     */
+    uint64_t discardedBytes() const noexcept;
+
+   private:
+    int32_t connect() noexcept;
+    bool waitForStop(std::chrono::milliseconds timeout) noexcept;
+    void readFromConnection(int32_t s) noexcept;
+    void receive() noexcept;
+
+   private:
+    NCOMUDPReceiver::Delegate m_delegate{};
+    std::string m_host{};
+    uint16_t m_port{0};
+    std::chrono::milliseconds m_maxBackoff{0};
+    int32_t m_stopFD{-1};
+
+    std::chrono::system_clock::time_point m_timeStamp{};
+    uint64_t m_packets{0};
+    NCOMFramer m_framer;
+
+    std::atomic<bool> m_isConnected{false};
+    std::atomic<uint32_t> m_connections{0};
+    std::atomic<uint64_t> m_discardedBytes{0};
+
+    bool m_valid{false};
+    std::atomic<bool> m_receiveThreadRunning{false};
+    std::thread m_receiveThread{};
+};
+
+#endif
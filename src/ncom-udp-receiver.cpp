@@ -0,0 +1,677 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cluon-complete.hpp"
+#include "ncom-udp-receiver.hpp"
+#include "ncom-relay.hpp"
+#include "split.hpp"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// io_uring's multishot recvmsg with provided buffer rings needs Linux 6.0 headers.
+#if defined(__has_include)
+    #if __has_include(<linux/io_uring.h>)
+        #include <linux/io_uring.h>
+    #endif
+#endif
+#if defined(IORING_RECV_MULTISHOT) && defined(__NR_io_uring_setup)
+    #define HAVE_IO_URING_RECV_MULTISHOT
+#endif
+
+#include <cerrno>
+#include <cstring>
+#include <array>
+#include <iostream>
+
+namespace {
+// Extract the kernel's receive time stamp and the socket's drop counter from a datagram's control messages.
+std::chrono::system_clock::time_point parseControl(struct msghdr &hdr, uint32_t &drops) noexcept {
+    std::chrono::system_clock::time_point timeStamp{std::chrono::system_clock::now()};
+    for (struct cmsghdr *c = CMSG_FIRSTHDR(&hdr); nullptr != c; c = CMSG_NXTHDR(&hdr, c)) {
+        if ( (SOL_SOCKET == c->cmsg_level) && (SO_TIMESTAMPNS == c->cmsg_type) ) {
+            struct timespec ts{};
+            std::memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+            timeStamp = std::chrono::system_clock::time_point{std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                std::chrono::seconds{ts.tv_sec} + std::chrono::nanoseconds{ts.tv_nsec})};
+        }
+        // Only present once the socket dropped datagrams; cumulative.
+        if ( (SOL_SOCKET == c->cmsg_level) && (SO_RXQ_OVFL == c->cmsg_type) ) {
+            std::memcpy(&drops, CMSG_DATA(c), sizeof(drops));
+        }
+    }
+    return timeStamp;
+}
+
+// Set the socket's receive buffer, exceeding net.core.rmem_max if permitted
+// (CAP_NET_ADMIN); @return effective size as reported by the kernel.
+uint32_t setReceiveBuffer(int32_t s, uint32_t size) noexcept {
+    const int SIZE{static_cast<int>(size)};
+    if (0 > ::setsockopt(s, SOL_SOCKET, SO_RCVBUFFORCE, &SIZE, sizeof(SIZE))) {
+        ::setsockopt(s, SOL_SOCKET, SO_RCVBUF, &SIZE, sizeof(SIZE));
+    }
+    int effective{0};
+    socklen_t length{sizeof(effective)};
+    ::getsockopt(s, SOL_SOCKET, SO_RCVBUF, &effective, &length);
+    return static_cast<uint32_t>(effective);
+}
+
+// Kernel memory charged per small datagram (payload plus sk_buff overhead).
+constexpr uint32_t BYTES_PER_DATAGRAM{2304};
+// Receive buffers hold this long a stall of the receiving thread.
+constexpr uint32_t HEADROOM_MILLISECONDS{1000};
+// Rate assumed until measured; OxTS units send up to 250Hz.
+constexpr uint32_t INITIAL_RATE{250};
+// Upper limit for all units' receive buffers together.
+constexpr uint64_t MAX_TOTAL_RECEIVE_BUFFER{64 * 1024 * 1024};
+
+constexpr std::size_t MAX_DATAGRAM{2048};
+constexpr std::size_t CONTROL{CMSG_SPACE(sizeof(struct timespec)) + CMSG_SPACE(sizeof(uint32_t))};
+
+#ifdef HAVE_IO_URING_RECV_MULTISHOT
+// Minimal io_uring submission/completion queue pair using the raw syscalls.
+class IOURing {
+   private:
+    IOURing(const IOURing &) = delete;
+    IOURing(IOURing &&)      = delete;
+    IOURing &operator=(const IOURing &) = delete;
+    IOURing &operator=(IOURing &&) = delete;
+
+   public:
+    explicit IOURing(uint32_t entries) noexcept {
+        struct io_uring_params params{};
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = entries * 8;
+        m_fd = static_cast<int32_t>(::syscall(__NR_io_uring_setup, entries, &params));
+        if (0 > m_fd) {
+            return;
+        }
+
+        m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+        m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        m_sqRing = ::mmap(nullptr, m_sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+        m_cqRing = ::mmap(nullptr, m_cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING);
+        m_sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+        void *sqes = ::mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES);
+        if ( (MAP_FAILED == m_sqRing) || (MAP_FAILED == m_cqRing) || (MAP_FAILED == sqes) ) {
+            return;
+        }
+        m_sqes = static_cast<struct io_uring_sqe *>(sqes);
+
+        char *sq = static_cast<char *>(m_sqRing);
+        m_sqHead = reinterpret_cast<uint32_t *>(sq + params.sq_off.head);
+        m_sqTail = reinterpret_cast<uint32_t *>(sq + params.sq_off.tail);
+        m_sqMask = *reinterpret_cast<uint32_t *>(sq + params.sq_off.ring_mask);
+        uint32_t *sqArray = reinterpret_cast<uint32_t *>(sq + params.sq_off.array);
+        for (uint32_t i{0}; i < params.sq_entries; i++) {
+            sqArray[i] = i;
+        }
+
+        char *cq = static_cast<char *>(m_cqRing);
+        m_cqHead = reinterpret_cast<uint32_t *>(cq + params.cq_off.head);
+        m_cqTail = reinterpret_cast<uint32_t *>(cq + params.cq_off.tail);
+        m_cqMask = *reinterpret_cast<uint32_t *>(cq + params.cq_off.ring_mask);
+        m_cqes = reinterpret_cast<struct io_uring_cqe *>(cq + params.cq_off.cqes);
+        m_isValid = true;
+    }
+
+    ~IOURing() noexcept {
+        if (nullptr != m_sqes) {
+            ::munmap(m_sqes, m_sqesSize);
+        }
+        if ( (nullptr != m_cqRing) && (MAP_FAILED != m_cqRing) ) {
+            ::munmap(m_cqRing, m_cqRingSize);
+        }
+        if ( (nullptr != m_sqRing) && (MAP_FAILED != m_sqRing) ) {
+            ::munmap(m_sqRing, m_sqRingSize);
+        }
+        if (0 <= m_fd) {
+            ::close(m_fd);
+        }
+    }
+
+    bool isValid() const noexcept {
+        return m_isValid;
+    }
+
+    int32_t fd() const noexcept {
+        return m_fd;
+    }
+
+    // @return Cleared submission queue entry, or nullptr when the queue is full.
+    struct io_uring_sqe *nextSQE() noexcept {
+        const uint32_t HEAD{__atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE)};
+        if (m_sqLocalTail - HEAD > m_sqMask) {
+            return nullptr;
+        }
+        struct io_uring_sqe *sqe = &m_sqes[m_sqLocalTail & m_sqMask];
+        std::memset(sqe, 0, sizeof(struct io_uring_sqe));
+        m_sqLocalTail++;
+        return sqe;
+    }
+
+    // Submit all prepared entries and wait for at least one completion.
+    int32_t submitAndWait() noexcept {
+        const uint32_t TAIL{*m_sqTail};
+        __atomic_store_n(m_sqTail, m_sqLocalTail, __ATOMIC_RELEASE);
+        return static_cast<int32_t>(::syscall(__NR_io_uring_enter, m_fd, m_sqLocalTail - TAIL, 1, IORING_ENTER_GETEVENTS, nullptr, 0));
+    }
+
+    // Call delegate for all available completions; @return number of completions.
+    template <typename Delegate>
+    uint32_t reap(Delegate &&delegate) noexcept {
+        uint32_t head{*m_cqHead};
+        const uint32_t TAIL{__atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE)};
+        const uint32_t COMPLETIONS{TAIL - head};
+        for (; head != TAIL; head++) {
+            delegate(m_cqes[head & m_cqMask]);
+        }
+        __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+        return COMPLETIONS;
+    }
+
+   private:
+    bool m_isValid{false};
+    int32_t m_fd{-1};
+    void *m_sqRing{nullptr};
+    std::size_t m_sqRingSize{0};
+    void *m_cqRing{nullptr};
+    std::size_t m_cqRingSize{0};
+    struct io_uring_sqe *m_sqes{nullptr};
+    std::size_t m_sqesSize{0};
+
+    uint32_t *m_sqHead{nullptr};
+    uint32_t *m_sqTail{nullptr};
+    uint32_t m_sqMask{0};
+    uint32_t m_sqLocalTail{0};
+
+    uint32_t *m_cqHead{nullptr};
+    uint32_t *m_cqTail{nullptr};
+    uint32_t m_cqMask{0};
+    struct io_uring_cqe *m_cqes{nullptr};
+};
+#endif
+}
+
+NCOMUDPReceiver::NCOMUDPReceiver(const std::vector<Unit> &units, Delegate delegate, Backend backend, NCOMRelay *relay) noexcept
+    : m_delegate(std::move(delegate))
+    , m_relay(relay)
+    , m_backend(backend)
+    , m_counters(new Counters[units.size()])
+    , m_datagramsAtLastAdaptation(units.size(), 0)
+    , m_dropsAtLastAdaptation(units.size(), 0)
+    , m_lastDropCounter(units.size(), 0)
+    , m_lastAdaptation(std::chrono::steady_clock::now()) {
+    m_epollFD = ::epoll_create1(EPOLL_CLOEXEC);
+    m_stopFD = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    bool allSocketsOpen{(0 <= m_epollFD) && (0 <= m_stopFD) && !units.empty()};
+
+    if (allSocketsOpen) {
+        struct epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u64 = units.size();
+        allSocketsOpen &= (0 == ::epoll_ctl(m_epollFD, EPOLL_CTL_ADD, m_stopFD, &ev));
+    }
+
+    for (std::size_t i{0}; allSocketsOpen && (i < units.size()); i++) {
+        const int32_t s{openSocket(units[i])};
+        if (0 > s) {
+            allSocketsOpen = false;
+            break;
+        }
+        m_sockets.push_back(s);
+        m_counters[i].receiveBuffer.store(setReceiveBuffer(s, INITIAL_RATE * BYTES_PER_DATAGRAM * HEADROOM_MILLISECONDS / 1000));
+
+        // The unit's index is the epoll cookie to dispatch without lookup.
+        struct epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u64 = i;
+        allSocketsOpen &= (0 == ::epoll_ctl(m_epollFD, EPOLL_CTL_ADD, s, &ev));
+    }
+
+    if (allSocketsOpen) {
+        m_valid = true;
+        m_readFromSocketsThreadRunning.store(true);
+        m_readFromSocketsThread = std::thread(&NCOMUDPReceiver::receive, this);
+    }
+}
+
+NCOMUDPReceiver::~NCOMUDPReceiver() noexcept {
+    m_readFromSocketsThreadRunning.store(false);
+    if (0 <= m_stopFD) {
+        ::eventfd_write(m_stopFD, 1);
+    }
+    try {
+        if (m_readFromSocketsThread.joinable()) {
+            m_readFromSocketsThread.join();
+        }
+    } catch (...) {}
+
+    for (auto s : m_sockets) {
+        ::close(s);
+    }
+    if (0 <= m_stopFD) {
+        ::close(m_stopFD);
+    }
+    if (0 <= m_epollFD) {
+        ::close(m_epollFD);
+    }
+}
+
+bool NCOMUDPReceiver::isValid() const noexcept {
+    return m_valid;
+}
+
+bool NCOMUDPReceiver::isRunning() const noexcept {
+    return m_readFromSocketsThreadRunning.load();
+}
+
+std::vector<NCOMUDPReceiver::Unit> NCOMUDPReceiver::parseUnits(const std::string &units) noexcept {
+    std::vector<Unit> retVal;
+    try {
+        for (auto entry : split(units, ',')) {
+            entry = stringtoolbox::trim(entry);
+            if (entry.empty()) {
+                continue;
+            }
+            auto fields = split(entry, ':');
+            if (3 != fields.size()) {
+                std::cerr << "[NCOMUDPReceiver] Malformed unit '" << entry << "', expected ip:port:id." << std::endl;
+                return std::vector<Unit>();
+            }
+            Unit u;
+            auto addressAndSource = split(fields[0], '@');
+            u.address = addressAndSource[0];
+            if (1 < addressAndSource.size()) {
+                // Only a multicast group can be restricted to a sender.
+                struct in_addr group{};
+                if ( (1 != ::inet_pton(AF_INET, u.address.c_str(), &group)) || !IN_MULTICAST(ntohl(group.s_addr)) ) {
+                    std::cerr << "[NCOMUDPReceiver] Malformed unit '" << entry << "', a source requires a multicast group." << std::endl;
+                    return std::vector<Unit>();
+                }
+                u.source = addressAndSource[1];
+            }
+            u.port = static_cast<uint16_t>(std::stoi(fields[1]));
+            u.senderStamp = static_cast<uint32_t>(std::stoul(fields[2]));
+            retVal.push_back(u);
+        }
+    } catch (...) {
+        std::cerr << "[NCOMUDPReceiver] Malformed unit list '" << units << "'." << std::endl;
+        retVal.clear();
+    }
+    return retVal;
+}
+
+int32_t NCOMUDPReceiver::openSocket(const Unit &unit) noexcept {
+    struct sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(unit.port);
+    if ( (0 == unit.port) || (1 != ::inet_pton(AF_INET, unit.address.c_str(), &address.sin_addr)) ) {
+        std::cerr << "[NCOMUDPReceiver] Invalid address " << unit.address << ":" << unit.port << std::endl;
+        return -1;
+    }
+
+    int32_t s = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_UDP);
+    if (0 > s) {
+        std::cerr << "[NCOMUDPReceiver] Error while creating socket: " << errno << std::endl;
+        return -1;
+    }
+
+    // Allow reusing of ports by multiple calls with same address/port.
+    const int YES{1};
+    ::setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &YES, sizeof(YES));
+    // Let the kernel time stamp every datagram on reception.
+    ::setsockopt(s, SOL_SOCKET, SO_TIMESTAMPNS, &YES, sizeof(YES));
+    // Let the kernel report the number of datagrams dropped on this socket.
+    ::setsockopt(s, SOL_SOCKET, SO_RXQ_OVFL, &YES, sizeof(YES));
+
+    if (0 > ::bind(s, reinterpret_cast<struct sockaddr *>(&address), sizeof(address))) {
+        std::cerr << "[NCOMUDPReceiver] Error while binding to " << unit.address << ":" << unit.port << ": " << errno << std::endl;
+        ::close(s);
+        return -1;
+    }
+
+    if (IN_MULTICAST(ntohl(address.sin_addr.s_addr))) {
+        struct in_addr interfaceAddress{};
+        if (1 != ::inet_pton(AF_INET, unit.interfaceAddress.c_str(), &interfaceAddress)) {
+            std::cerr << "[NCOMUDPReceiver] Invalid interface address " << unit.interfaceAddress << std::endl;
+            ::close(s);
+            return -1;
+        }
+
+        int32_t retVal{-1};
+        if (unit.source.empty()) {
+            // Any-source multicast: Join the group.
+            struct ip_mreq mreq{};
+            mreq.imr_multiaddr = address.sin_addr;
+            mreq.imr_interface = interfaceAddress;
+            retVal = ::setsockopt(s, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq));
+        } else {
+            // Source-specific multicast: The kernel filters all other senders to this group.
+            struct ip_mreq_source mreq{};
+            mreq.imr_multiaddr = address.sin_addr;
+            mreq.imr_interface = interfaceAddress;
+            if (1 != ::inet_pton(AF_INET, unit.source.c_str(), &mreq.imr_sourceaddr)) {
+                std::cerr << "[NCOMUDPReceiver] Invalid source address " << unit.source << std::endl;
+                ::close(s);
+                return -1;
+            }
+            retVal = ::setsockopt(s, IPPROTO_IP, IP_ADD_SOURCE_MEMBERSHIP, &mreq, sizeof(mreq));
+        }
+        if (0 > retVal) {
+            std::cerr << "[NCOMUDPReceiver] Error while joining multicast group " << unit.address << ": " << errno << std::endl;
+            ::close(s);
+            return -1;
+        }
+
+        // Do not receive datagrams for other groups using the same port.
+        const int NO{0};
+        ::setsockopt(s, IPPROTO_IP, IP_MULTICAST_ALL, &NO, sizeof(NO));
+    } else if (!unit.source.empty()) {
+        // The kernel filters by source for multicast groups only.
+        std::cerr << "[NCOMUDPReceiver] Source address " << unit.source << " requires a multicast group, not " << unit.address << std::endl;
+        ::close(s);
+        return -1;
+    }
+    return s;
+}
+
+NCOMUDPReceiver::Backend NCOMUDPReceiver::backend() const noexcept {
+    return m_backend.load();
+}
+
+NCOMUDPReceiver::Statistics NCOMUDPReceiver::statistics(std::size_t unit) const noexcept {
+    Statistics retVal;
+    if (unit < m_sockets.size()) {
+        retVal.datagrams = m_counters[unit].datagrams.load(std::memory_order_relaxed);
+        retVal.drops = m_counters[unit].drops.load(std::memory_order_relaxed);
+        retVal.rate = m_counters[unit].rate.load(std::memory_order_relaxed);
+        retVal.receiveBuffer = m_counters[unit].receiveBuffer.load(std::memory_order_relaxed);
+    }
+    return retVal;
+}
+
+std::chrono::system_clock::time_point NCOMUDPReceiver::account(std::size_t unit, struct msghdr &hdr) noexcept {
+    uint32_t drops{0};
+    const std::chrono::system_clock::time_point timeStamp{parseControl(hdr, drops)};
+    m_counters[unit].datagrams.fetch_add(1, std::memory_order_relaxed);
+    // The kernel's counter is 32 bits wide and wraps; unsigned subtraction
+    // yields the datagrams dropped since the last one regardless. A missing
+    // counter means that it is 0.
+    const uint32_t DELTA{drops - m_lastDropCounter[unit]};
+    m_lastDropCounter[unit] = drops;
+    if (0 < DELTA) {
+        m_counters[unit].drops.fetch_add(DELTA, std::memory_order_relaxed);
+    }
+    return timeStamp;
+}
+
+void NCOMUDPReceiver::adaptReceiveBuffers() noexcept {
+    const std::chrono::steady_clock::time_point NOW{std::chrono::steady_clock::now()};
+    const int64_t ELAPSED{std::chrono::duration_cast<std::chrono::milliseconds>(NOW - m_lastAdaptation).count()};
+    if (1000 > ELAPSED) {
+        return;
+    }
+    m_lastAdaptation = NOW;
+
+    // All units share one budget as they are drained by the same thread.
+    const uint64_t MAX_RECEIVE_BUFFER{MAX_TOTAL_RECEIVE_BUFFER / m_sockets.size()};
+    for (std::size_t unit{0}; unit < m_sockets.size(); unit++) {
+        Counters &c = m_counters[unit];
+        const uint64_t DATAGRAMS{c.datagrams.load(std::memory_order_relaxed)};
+        const uint64_t RATE{(DATAGRAMS - m_datagramsAtLastAdaptation[unit]) * 1000 / static_cast<uint64_t>(ELAPSED)};
+        m_datagramsAtLastAdaptation[unit] = DATAGRAMS;
+        c.rate.store(static_cast<uint32_t>(RATE), std::memory_order_relaxed);
+
+        // Only grow: Hold HEADROOM_MILLISECONDS at the measured rate; double
+        // the buffer if the kernel dropped datagrams regardless.
+        const uint64_t CURRENT{c.receiveBuffer.load(std::memory_order_relaxed)};
+        const uint64_t DROPS{c.drops.load(std::memory_order_relaxed)};
+        uint64_t required{RATE * BYTES_PER_DATAGRAM * HEADROOM_MILLISECONDS / 1000};
+        if (DROPS > m_dropsAtLastAdaptation[unit]) {
+            required = (required > CURRENT * 2) ? required : CURRENT * 2;
+        }
+        m_dropsAtLastAdaptation[unit] = DROPS;
+        required = (required < MAX_RECEIVE_BUFFER) ? required : MAX_RECEIVE_BUFFER;
+        if (required > CURRENT) {
+            c.receiveBuffer.store(setReceiveBuffer(m_sockets[unit], static_cast<uint32_t>(required)), std::memory_order_relaxed);
+        }
+    }
+}
+
+void NCOMUDPReceiver::receive() noexcept {
+    if ( (Backend::IO_URING == m_backend.load()) && !readWithIOURing() ) {
+        std::cerr << "[NCOMUDPReceiver] io_uring with multishot recvmsg is not supported; falling back to epoll." << std::endl;
+        m_backend.store(Backend::EPOLL);
+    }
+    if (Backend::EPOLL == m_backend.load()) {
+        readFromSockets();
+    }
+    m_readFromSocketsThreadRunning.store(false);
+}
+
+void NCOMUDPReceiver::readFromSockets() noexcept {
+    constexpr std::size_t MAX_EVENTS{16};
+    constexpr std::size_t BATCH{32};
+
+    std::vector<char> buffers(BATCH * MAX_DATAGRAM);
+    std::vector<char> controls(BATCH * CONTROL);
+    std::array<struct iovec, BATCH> iovecs{};
+    std::array<struct mmsghdr, BATCH> messages{};
+
+    std::array<struct epoll_event, MAX_EVENTS> events{};
+    while (m_readFromSocketsThreadRunning.load()) {
+        const int READY{::epoll_wait(m_epollFD, events.data(), static_cast<int>(events.size()), -1)};
+        if (0 > READY) {
+            if (EINTR == errno) {
+                continue;
+            }
+            std::cerr << "[NCOMUDPReceiver] Error while waiting for data: " << errno << std::endl;
+            break;
+        }
+
+        for (int e{0}; e < READY; e++) {
+            const std::size_t UNIT{static_cast<std::size_t>(events[static_cast<std::size_t>(e)].data.u64)};
+            if (UNIT >= m_sockets.size()) {
+                // Stop was requested.
+                continue;
+            }
+
+            // Drain the socket in batches.
+            int received{0};
+            do {
+                for (std::size_t i{0}; i < BATCH; i++) {
+                    iovecs[i].iov_base = &buffers[i * MAX_DATAGRAM];
+                    iovecs[i].iov_len = MAX_DATAGRAM;
+                    std::memset(&messages[i].msg_hdr, 0, sizeof(struct msghdr));
+                    messages[i].msg_hdr.msg_iov = &iovecs[i];
+                    messages[i].msg_hdr.msg_iovlen = 1;
+                    messages[i].msg_hdr.msg_control = &controls[i * CONTROL];
+                    messages[i].msg_hdr.msg_controllen = CONTROL;
+                }
+
+                received = ::recvmmsg(m_sockets[UNIT], messages.data(), BATCH, MSG_DONTWAIT, nullptr);
+                for (int i{0}; i < received; i++) {
+                    struct msghdr &hdr = messages[static_cast<std::size_t>(i)].msg_hdr;
+                    const std::chrono::system_clock::time_point timeStamp{account(UNIT, hdr)};
+                    if (nullptr != m_delegate) {
+                        m_delegate(UNIT, static_cast<const char *>(hdr.msg_iov->iov_base), messages[static_cast<std::size_t>(i)].msg_len, timeStamp);
+                    }
+                }
+
+                // Forward the batch only after it was decoded.
+                if ( (nullptr != m_relay) && (0 < received) ) {
+                    for (int i{0}; i < received; i++) {
+                        m_relay->add(static_cast<const char *>(iovecs[static_cast<std::size_t>(i)].iov_base), messages[static_cast<std::size_t>(i)].msg_len);
+                    }
+                    m_relay->flush();
+                }
+            } while (static_cast<std::size_t>(received) == BATCH);
+        }
+        adaptReceiveBuffers();
+    }
+}
+
+bool NCOMUDPReceiver::readWithIOURing() noexcept {
+#ifdef HAVE_IO_URING_RECV_MULTISHOT
+    constexpr uint16_t BUFFER_GROUP{0};
+    // Must be a power of two; each buffer holds one datagram with its headers.
+    constexpr uint32_t BUFFERS{256};
+    constexpr std::size_t BUFFER_SIZE{sizeof(struct io_uring_recvmsg_out) + CONTROL + MAX_DATAGRAM};
+
+    // One multishot request per socket plus the stop request.
+    const uint32_t ENTRIES{static_cast<uint32_t>(m_sockets.size() + 1)};
+    IOURing ring((ENTRIES < 64) ? 64 : ENTRIES);
+    if (!ring.isValid()) {
+        return false;
+    }
+
+    // Provided buffer ring: The kernel picks a free buffer for each datagram.
+    const std::size_t BUFFER_RING_SIZE{BUFFERS * sizeof(struct io_uring_buf)};
+    void *bufferRingMemory = ::mmap(nullptr, BUFFER_RING_SIZE, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (MAP_FAILED == bufferRingMemory) {
+        return false;
+    }
+    struct io_uring_buf_ring *bufferRing = static_cast<struct io_uring_buf_ring *>(bufferRingMemory);
+    // Index the entries directly: In C++, the flexible array io_uring_buf_ring::bufs
+    // is preceded by a one-byte empty struct and hence misplaced.
+    struct io_uring_buf *bufferRingEntries = static_cast<struct io_uring_buf *>(bufferRingMemory);
+    std::vector<char> buffers(BUFFERS * BUFFER_SIZE);
+
+    struct io_uring_buf_reg reg{};
+    reg.ring_addr = reinterpret_cast<uint64_t>(bufferRing);
+    reg.ring_entries = BUFFERS;
+    reg.bgid = BUFFER_GROUP;
+    if (0 > ::syscall(__NR_io_uring_register, ring.fd(), IORING_REGISTER_PBUF_RING, &reg, 1)) {
+        ::munmap(bufferRingMemory, BUFFER_RING_SIZE);
+        return false;
+    }
+
+    uint16_t bufferRingTail{0};
+    auto provideBuffer = [bufferRingEntries, &buffers, &bufferRingTail, BUFFERS, BUFFER_SIZE](uint16_t bid) {
+        struct io_uring_buf *b = &bufferRingEntries[bufferRingTail & (BUFFERS - 1)];
+        b->addr = reinterpret_cast<uint64_t>(&buffers[bid * BUFFER_SIZE]);
+        b->len = static_cast<uint32_t>(BUFFER_SIZE);
+        b->bid = bid;
+        bufferRingTail++;
+    };
+    for (uint16_t bid{0}; bid < BUFFERS; bid++) {
+        provideBuffer(bid);
+    }
+    __atomic_store_n(&bufferRing->tail, bufferRingTail, __ATOMIC_RELEASE);
+
+    // Layout template for multishot recvmsg: No source address, room for control messages.
+    struct msghdr layout{};
+    layout.msg_controllen = CONTROL;
+
+    const uint64_t STOP{m_sockets.size()};
+    auto armReceive = [&ring, &layout, this](std::size_t unit) {
+        struct io_uring_sqe *sqe = ring.nextSQE();
+        if (nullptr != sqe) {
+            sqe->opcode = IORING_OP_RECVMSG;
+            sqe->fd = m_sockets[unit];
+            sqe->addr = reinterpret_cast<uint64_t>(&layout);
+            sqe->len = 1;
+            sqe->ioprio = IORING_RECV_MULTISHOT;
+            sqe->flags = IOSQE_BUFFER_SELECT;
+            sqe->buf_group = BUFFER_GROUP;
+            sqe->user_data = unit;
+        }
+    };
+    for (std::size_t unit{0}; unit < m_sockets.size(); unit++) {
+        armReceive(unit);
+    }
+    {
+        struct io_uring_sqe *sqe = ring.nextSQE();
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = m_stopFD;
+        sqe->poll32_events = POLLIN;
+        sqe->user_data = STOP;
+    }
+
+    bool supported{true};
+    bool receivedAny{false};
+    while (supported && m_readFromSocketsThreadRunning.load()) {
+        if ( (0 > ring.submitAndWait()) && (EINTR != errno) ) {
+            std::cerr << "[NCOMUDPReceiver] Error while waiting for completions: " << errno << std::endl;
+            break;
+        }
+
+        // Reap all completions in one go; recycled buffers are published once per batch.
+        ring.reap([&](const struct io_uring_cqe &cqe) {
+            if (STOP == cqe.user_data) {
+                return;
+            }
+            const std::size_t UNIT{static_cast<std::size_t>(cqe.user_data)};
+            if (0 > cqe.res) {
+                if ( (-EINVAL == cqe.res) && !receivedAny ) {
+                    supported = false;
+                } else if (-ENOBUFS != cqe.res) {
+                    std::cerr << "[NCOMUDPReceiver] Error while receiving: " << -cqe.res << std::endl;
+                }
+            } else if (cqe.flags & IORING_CQE_F_BUFFER) {
+                receivedAny = true;
+                const uint16_t BID{static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT)};
+                char *buffer = &buffers[BID * BUFFER_SIZE];
+                const struct io_uring_recvmsg_out *out = reinterpret_cast<const struct io_uring_recvmsg_out *>(buffer);
+
+                struct msghdr hdr{};
+                hdr.msg_control = buffer + sizeof(struct io_uring_recvmsg_out) + layout.msg_namelen;
+                hdr.msg_controllen = out->controllen;
+                const char *payload = buffer + sizeof(struct io_uring_recvmsg_out) + layout.msg_namelen + layout.msg_controllen;
+                const std::size_t AVAILABLE{static_cast<std::size_t>(cqe.res) - static_cast<std::size_t>(payload - buffer)};
+                const std::size_t LENGTH{(out->payloadlen < AVAILABLE) ? out->payloadlen : AVAILABLE};
+
+                if (nullptr != m_delegate) {
+                    m_delegate(UNIT, payload, LENGTH, account(UNIT, hdr));
+                }
+                if (nullptr != m_relay) {
+                    m_relay->add(payload, LENGTH);
+                }
+                // The kernel reuses the buffer only after the batch.
+                provideBuffer(BID);
+            }
+
+            // The kernel ends a multishot request on errors like running out of buffers.
+            if ( supported && !(cqe.flags & IORING_CQE_F_MORE) ) {
+                armReceive(UNIT);
+            }
+        });
+        if (nullptr != m_relay) {
+            m_relay->flush();
+        }
+        __atomic_store_n(&bufferRing->tail, bufferRingTail, __ATOMIC_RELEASE);
+        adaptReceiveBuffers();
+    }
+
+    struct io_uring_buf_reg unreg{};
+    unreg.bgid = BUFFER_GROUP;
+    ::syscall(__NR_io_uring_register, ring.fd(), IORING_UNREGISTER_PBUF_RING, &unreg, 1);
+    ::munmap(bufferRingMemory, BUFFER_RING_SIZE);
+    return supported;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NCOM_UDP_RECEIVER
+#define NCOM_UDP_RECEIVER
+
+#include <sys/socket.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+class NCOMRelay;
+
+/**
+ * Receives NCOM datagrams from one or more OxTS units on a single thread
+ * using one epoll event loop; datagrams are read in batches with recvmmsg.
+ * Alternatively, datagrams are received with io_uring's multishot recvmsg
+ * into a ring of kernel-provided buffers and completions are reaped in
+ * batches, falling back to epoll on kernels without support.
+ *
+ * The sockets' receive buffers are sized from the measured packet rate of
+ * each unit and grown whenever the kernel reports dropped datagrams.
+ *
+ * Optionally, all received datagrams are forwarded from the receive buffers
+ * through an NCOMRelay once per batch after they were handed to the delegate.
+ */
+class NCOMUDPReceiver {
+   public:
+    enum class Backend : uint8_t {
+        EPOLL,
+        IO_URING,
+    };
+
+    class Unit {
+       public:
+        std::string address{"0.0.0.0"};
+        uint16_t port{0};
+        uint32_t senderStamp{0};
+        // Only for multicast addresses: Accept datagrams from this source only (SSM).
+        std::string source{};
+        // Only for multicast addresses: Local interface address to join the group on.
+        std::string interfaceAddress{"0.0.0.0"};
+    };
+
+    /**
+     * Counters for one unit; safe to read while receiving.
+     */
+    class Statistics {
+       public:
+        uint64_t datagrams{0};
+        // Datagrams dropped by the kernel as the socket's buffer was full.
+        uint64_t drops{0};
+        // Packets per second measured over the last interval.
+        uint32_t rate{0};
+        // Effective receive buffer size in bytes.
+        uint32_t receiveBuffer{0};
+    };
+
+    /**
+     * Delegate called for each received datagram; parameters are index of the
+     * unit in the list given to the constructor, data, length, and the time
+     * stamp when the datagram was received by the kernel.
+     */
+    using Delegate = std::function<void(std::size_t, const char *, std::size_t, const std::chrono::system_clock::time_point &)>;
+
+   private:
+    NCOMUDPReceiver(const NCOMUDPReceiver &) = delete;
+    NCOMUDPReceiver(NCOMUDPReceiver &&)      = delete;
+    NCOMUDPReceiver &operator=(const NCOMUDPReceiver &) = delete;
+    NCOMUDPReceiver &operator=(NCOMUDPReceiver &&) = delete;
+
+   public:
+    /**
+     * Constructor.
+     *
+     * @param units List of units to receive from.
+     * @param delegate Functional to handle received datagrams.
+     * @param backend Receive backend to try first.
+     * @param relay Relay to forward all received datagrams to; may be nullptr.
+     */
+    NCOMUDPReceiver(const std::vector<Unit> &units, Delegate delegate, Backend backend = Backend::EPOLL, NCOMRelay *relay = nullptr) noexcept;
+    ~NCOMUDPReceiver() noexcept;
+
+    /**
+     * @return true if all sockets could be opened.
+     */
+    bool isValid() const noexcept;
+
+    /**
+     * @return true while the event loop is running.
+     */
+    bool isRunning() const noexcept;
+
+    /**
+     * @return Backend in use; changes to EPOLL if io_uring turned out to be unsupported.
+     */
+    Backend backend() const noexcept;
+
+    /**
+     * @param unit Index of the unit in the list given to the constructor.
+     * @return Counters for the given unit.
+     */
+    Statistics statistics(std::size_t unit) const noexcept;
+
+    /**
+     * Parse a comma-separated list of units given as ip:port:id; a multicast
+     * group can be restricted to a single sender given as group@source:port:id,
+     * a source for any other address is rejected.
+     *
+     * @param units List of units.
+     * @return Parsed units; empty if any entry is malformed.
+     */
+    static std::vector<Unit> parseUnits(const std::string &units) noexcept;
+
+   private:
+    int32_t openSocket(const Unit &unit) noexcept;
+    void receive() noexcept;
+    void readFromSockets() noexcept;
+    bool readWithIOURing() noexcept;
+    std::chrono::system_clock::time_point account(std::size_t unit, struct msghdr &hdr) noexcept;
+    void adaptReceiveBuffers() noexcept;
+
+   private:
+    class Counters {
+       public:
+        std::atomic<uint64_t> datagrams{0};
+        std::atomic<uint64_t> drops{0};
+        std::atomic<uint32_t> rate{0};
+        std::atomic<uint32_t> receiveBuffer{0};
+    };
+
+   private:
+    Delegate m_delegate{};
+    NCOMRelay *m_relay{nullptr};
+    std::atomic<Backend> m_backend{Backend::EPOLL};
+    std::vector<int32_t> m_sockets{};
+    int32_t m_epollFD{-1};
+    int32_t m_stopFD{-1};
+
+    std::unique_ptr<Counters[]> m_counters{};
+    std::vector<uint64_t> m_datagramsAtLastAdaptation{};
+    std::vector<uint64_t> m_dropsAtLastAdaptation{};
+    // Last value of each socket's SO_RXQ_OVFL counter.
+    std::vector<uint32_t> m_lastDropCounter{};
+    std::chrono::steady_clock::time_point m_lastAdaptation{};
+
+    bool m_valid{false};
+    std::atomic<bool> m_readFromSocketsThreadRunning{false};
+    std::thread m_readFromSocketsThread{};
+};
+
+#endif
@@ -19,127 +19,504 @@
 #include "opendlv-standard-message-set.hpp"
 
 #include "ncom-decoder.hpp"
+#include "nav-state.hpp"
+#include "nav-state-publisher.hpp"
+#include "nav-state-server.hpp"
+#include "ncom-file-reader.hpp"
+#include "ncom-packet-capture.hpp"
+#include "ncom-recorder.hpp"
+#include "ncom-relay.hpp"
+#include "ncom-serial-receiver.hpp"
+#include "ncom-tcp-receiver.hpp"
+#include "ncom-udp-receiver.hpp"
+#include "shared-nav-state.hpp"
+#include "shared-nav-state-history.hpp"
+#include "spsc-ring.hpp"
+#include "split.hpp"
 
+#include <cmath>
 #include <cstdint>
+#include <atomic>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <thread>
+#include <utility>
+#include <vector>
 
 int32_t main(int32_t argc, char **argv) {
     int32_t retCode{0};
     auto commandlineArguments = cluon::getCommandlineArguments(argc, argv);
-    if ( (0 == commandlineArguments.count("ncom_port")) || (0 == commandlineArguments.count("cid")) ) {
+    if ( ((0 == commandlineArguments.count("ncom_port")) && (0 == commandlineArguments.count("ncom_units")) && (0 == commandlineArguments.count("ncom_serial")) && (0 == commandlineArguments.count("ncom_tcp")) && (0 == commandlineArguments.count("ncom_file"))) || (0 == commandlineArguments.count("cid")) ) {
         std::cerr << argv[0] << " decodes latitude/longitude/heading from an OXTS GPS/INSS unit in NCOM format and publishes it to a running OpenDaVINCI session using the OpenDLV Standard Message Set." << std::endl;
-        std::cerr << "Usage:   " << argv[0] << " [--ncom_ip=<IPv4-address>] --ncom_port=<port> --cid=<OpenDaVINCI session> [--id=<Identifier in case of multiple OxTS units>] [--nogpstime] [--verbose]" << std::endl;
+        std::cerr << "Usage:   " << argv[0] << " [--ncom_ip=<IPv4-address> [--ncom_source=<IPv4-address of the only sender to accept on a multicast group>]] --ncom_port=<port> | --ncom_units=<ip[@source]:port:id>[,<ip[@source]:port:id>...] [--ncom_iface=<IPv4-address of interface to join multicast groups on>] [--ncom_backend=epoll|io_uring] [--ncom_tee=<ip:port>[,<ip:port>...] to forward all datagrams to] [--ncom_record=<file to append all received packets to> [--ncom_record_size=<MiB to preallocate, default 1024>] [--ncom_record_sync=<ms, default 1000>]] [--ncom_capture=<network interface to capture from using a TPACKET_V3 ring instead of sockets>] | --ncom_serial=<serial device> [--baud=<baud rate, default 115200>] | --ncom_tcp=<host:port of NCOM relay> | --ncom_file=<file, named pipe, or - for stdin with raw NCOM> [--gps_paced] --cid=<OpenDaVINCI session> [--id=<Identifier in case of multiple OxTS units>] [--nogpstime] [--publisher_queue=<entries to publish from a separate thread>] [--publisher_overflow=drop_oldest|drop_newest|keep_latest|block] [--nav_state | --nav_state_only] [--attitude] [--status [--status_heartbeat=<s, default 1>] [--status_deadbands=position:<m>,velocity:<m/s>,orientation:<rad>]] [--raw] [--rates=<message:Hz>[,<message:Hz>...] [--decimation=time|packets [--ncom_rate=<Hz, default 100>]]] [--routes=<cid>:<message[:Hz]>[,<message[:Hz]>...][/<cid>:...], a route for --cid replaces --rates and keeps --status] [--subscriptions | --on_demand [--subscription_lease=<s until a subscription not renewed expires, default 10, 0 for never>]] [--local_socket=<path, or @name in the abstract namespace, to serve NavStateRecords on>] [--shm_nav_state=<name of shared memory with the latest NavStateRecord per unit>] [--shm_history=<name of shared memory with recent NavStateRecords per unit>[:<seconds at --ncom_rate, default 10 at 250 Hz>]] [--metrics] [--verbose]" << std::endl;
         std::cerr << "Example: " << argv[0] << " --ncom_ip=0.0.0.0 --ncom_port=3000 --cid=111" << std::endl;
+        std::cerr << "         " << argv[0] << " --ncom_units=0.0.0.0:3000:0,0.0.0.0:3001:1 --cid=111" << std::endl;
+        std::cerr << "         " << argv[0] << " --ncom_ip=239.1.2.3 --ncom_source=195.0.0.33 --ncom_port=3000 --cid=111" << std::endl;
+        std::cerr << "         " << argv[0] << " --ncom_serial=/dev/ttyUSB0 --baud=230400 --cid=111" << std::endl;
+        std::cerr << "         " << argv[0] << " --ncom_tcp=192.168.0.10:3000 --cid=111" << std::endl;
+        std::cerr << "         " << argv[0] << " --ncom_port=3000 --rates=Geolocation:20,GeodeticWgs84Reading:10 --cid=111" << std::endl;
+        std::cerr << "         " << argv[0] << " --ncom_port=3000 --routes=112:AccelerationReading,AngularVelocityReading/111:Geolocation:10 --cid=111" << std::endl;
+        std::cerr << "         " << argv[0] << " --ncom_port=3000 --on_demand --cid=111" << std::endl;
+        std::cerr << "         " << "zcat recording.ncom.gz | " << argv[0] << " --ncom_file=- --gps_paced --cid=111" << std::endl;
         retCode = 1;
     } else {
         const uint32_t ID{(commandlineArguments["id"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["id"])) : 0};
         const bool VERBOSE{commandlineArguments.count("verbose") != 0};
         const bool DONT_USE_GPSTIME{commandlineArguments.count("nogpstime") != 0};
+        const bool METRICS{commandlineArguments.count("metrics") != 0};
+        const bool RAW{commandlineArguments.count("raw") != 0};
+        const NavStatePublisher::Messages MESSAGES{(commandlineArguments.count("nav_state_only") != 0) ? NavStatePublisher::Messages::COMPOUND
+            : ((commandlineArguments.count("nav_state") != 0) ? NavStatePublisher::Messages::BOTH : NavStatePublisher::Messages::STANDARD)};
 
-        // Interface to a running OpenDaVINCI session (ignoring any incoming Envelopes).
-        cluon::OD4Session od4{static_cast<uint16_t>(std::stoi(commandlineArguments["cid"])),
-            [](auto){}
-        };
+        // Envelopes are pre-serialized and only patched with the new values.
+        const uint16_t CID{static_cast<uint16_t>(std::stoi(commandlineArguments["cid"]))};
+        NavStatePublisher toOD4{CID, MESSAGES, commandlineArguments.count("attitude") != 0};
+        const bool STATUS{commandlineArguments.count("status") != 0};
+        StatusFilter::Deadbands deadbands;
+        const float HEARTBEAT{(commandlineArguments["status_heartbeat"].size() != 0) ? std::stof(commandlineArguments["status_heartbeat"]) : 1.0f};
+        if (STATUS) {
+            if (!StatusFilter::parseDeadbands(commandlineArguments["status_deadbands"], deadbands)) {
+                std::cerr << argv[0] << ": invalid --status_deadbands." << std::endl;
+                return 1;
+            }
+            toOD4.enableStatus(deadbands, std::chrono::microseconds{static_cast<int64_t>(HEARTBEAT * 1000000.0f)});
+        }
 
-        // Interface to OxTS unit providing data in NCOM format.
-        const std::string NCOM_ADDRESS((commandlineArguments.count("ncom_ip") == 0) ? "0.0.0.0" : commandlineArguments["ncom_ip"]);
-        const uint32_t NCOM_PORT(std::stoi(commandlineArguments["ncom_port"]));
-        NCOMDecoder ncomDecoder;
-        cluon::UDPReceiver fromDevice(NCOM_ADDRESS, NCOM_PORT,
-            [&od4Session = od4, &decoder = ncomDecoder, senderStamp = ID, VERBOSE, DONT_USE_GPSTIME](std::string &&d, std::string &&/*from*/, std::chrono::system_clock::time_point &&tp) noexcept {
-            auto retVal = decoder.decode(d);
-            if (retVal.first) {
-                cluon::data::TimeStamp sampleTime = cluon::time::convert(tp);
+        // Decimate on sample time (i.e., GPS time unless --nogpstime) by default.
+        const Decimator::Mode DECIMATION{(commandlineArguments["decimation"] == "packets") ? Decimator::Mode::PACKET_COUNT : Decimator::Mode::SAMPLE_TIME};
+        const float NCOM_RATE{(commandlineArguments["ncom_rate"].size() != 0) ? std::stof(commandlineArguments["ncom_rate"]) : 100.0f};
+        if (0 != commandlineArguments.count("rates")) {
+            if (!toOD4.setRates(commandlineArguments["rates"], DECIMATION, NCOM_RATE)) {
+                std::cerr << argv[0] << ": invalid --rates." << std::endl;
+                return 1;
+            }
+        }
 
-                // Check whether we should use the OxTS' GPS time for sample time
-                // and whether we have a valid time stamp.
-                if ( !DONT_USE_GPSTIME && (0 < cluon::time::toMicroseconds(retVal.second.sampleTime)) ) {
-                    sampleTime = retVal.second.sampleTime;
+        // Optionally, route message types to further sessions at their own rates.
+        std::vector<std::unique_ptr<NavStatePublisher>> routes;
+        if (0 != commandlineArguments.count("routes")) {
+            for (auto route : split(commandlineArguments["routes"], '/')) {
+                route = stringtoolbox::trim(route);
+                if (route.empty()) {
+                    continue;
+                }
+                // The session's id comes first, e.g., 112:AccelerationReading,Geolocation:10.
+                const std::string::size_type COLON{route.find(':')};
+                std::string cidField{route.substr(0, COLON)};
+                cidField = stringtoolbox::trim(cidField);
+                int32_t routeCID{0};
+                if ( (std::string::npos != COLON) && !cidField.empty() && (4 > cidField.size()) && (std::string::npos == cidField.find_first_not_of("0123456789")) ) {
+                    routeCID = std::stoi(cidField);
+                }
+                if ( (1 > routeCID) || (255 < routeCID) ) {
+                    std::cerr << argv[0] << ": invalid --routes entry '" << route << "', expected <cid 1..255>:<message[:Hz]>[,<message[:Hz]>...]." << std::endl;
+                    return 1;
+                }
+                const uint16_t ROUTE_CID{static_cast<uint16_t>(routeCID)};
+                if (CID == ROUTE_CID) {
+                    // A route for --cid selects exactly its message types, which would silently replace --rates.
+                    if (0 != commandlineArguments.count("rates")) {
+                        std::cerr << argv[0] << ": --routes entry '" << route << "' for --cid cannot be combined with --rates." << std::endl;
+                        return 1;
+                    }
+                    if (!toOD4.setRates(route.substr(COLON + 1), DECIMATION, NCOM_RATE, true)) {
+                        std::cerr << argv[0] << ": invalid --routes entry '" << route << "'." << std::endl;
+                        return 1;
+                    }
+                    if (STATUS) {
+                        toOD4.enableStatus(deadbands, std::chrono::microseconds{static_cast<int64_t>(HEARTBEAT * 1000000.0f)});
+                    }
+                    continue;
+                }
+                std::unique_ptr<NavStatePublisher> publisher{new NavStatePublisher(ROUTE_CID, NavStatePublisher::Messages::BOTH, true)};
+                if (STATUS) {
+                    publisher->enableStatus(deadbands, std::chrono::microseconds{static_cast<int64_t>(HEARTBEAT * 1000000.0f)});
+                }
+                if (!publisher->isValid() || !publisher->setRates(route.substr(COLON + 1), DECIMATION, NCOM_RATE, true)) {
+                    std::cerr << argv[0] << ": invalid --routes entry '" << route << "'." << std::endl;
+                    return 1;
                 }
+                routes.push_back(std::move(publisher));
+            }
+        }
 
-                opendlv::proxy::AccelerationReading msg1 = retVal.second.acceleration;
-                od4Session.send(msg1, sampleTime, senderStamp);
+        const bool ON_DEMAND{commandlineArguments.count("on_demand") != 0};
+        const bool SUBSCRIPTIONS{ON_DEMAND || (commandlineArguments.count("subscriptions") != 0)};
+        const float LEASE{(commandlineArguments["subscription_lease"].size() != 0) ? std::stof(commandlineArguments["subscription_lease"]) : 10.0f};
+        if (SUBSCRIPTIONS) {
+            toOD4.enableSubscriptions(ON_DEMAND, DECIMATION, NCOM_RATE, std::chrono::milliseconds{static_cast<int64_t>(LEASE * 1000.0f)});
+        }
 
-                opendlv::proxy::AngularVelocityReading msg2 = retVal.second.angularVelocity;
-                od4Session.send(msg2, sampleTime, senderStamp);
+        // Interface to a running OpenDaVINCI session; only subscription
+        // requests are handled, which are applied before the next packet.
+        cluon::OD4Session od4{CID,
+            [&toOD4, SUBSCRIPTIONS, VERBOSE](cluon::data::Envelope &&env){
+                if (SUBSCRIPTIONS && (opendlv::device::gps::ncom::SubscriptionRequest::ID() == env.dataType())) {
+                    const uint32_t REQUESTER{env.senderStamp()};
+                    auto request = cluon::extractMessage<opendlv::device::gps::ncom::SubscriptionRequest>(std::move(env));
+                    const bool ACCEPTED{toOD4.subscribe(REQUESTER, request.name(), request.rate())};
+                    if (VERBOSE || !ACCEPTED) {
+                        std::cerr << "[opendlv-device-gps-ncom]: Subscription of " << REQUESTER << " to " << request.name() << " at " << request.rate() << " Hz " << (ACCEPTED ? "accepted." : "rejected.") << std::endl;
+                    }
+                }
+            }
+        };
+
+        // Interface to OxTS units providing data in NCOM format; all units are served from one event loop.
+        std::vector<NCOMUDPReceiver::Unit> units;
+        if (0 != commandlineArguments.count("ncom_units")) {
+            units = NCOMUDPReceiver::parseUnits(commandlineArguments["ncom_units"]);
+            if (units.empty()) {
+                std::cerr << argv[0] << ": invalid --ncom_units." << std::endl;
+                return 1;
+            }
+        } else if ( (0 != commandlineArguments.count("ncom_serial")) || (0 != commandlineArguments.count("ncom_tcp")) || (0 != commandlineArguments.count("ncom_file")) ) {
+            NCOMUDPReceiver::Unit unit;
+            unit.senderStamp = ID;
+            units.push_back(unit);
+        } else {
+            // Same as a single entry of --ncom_units, so that a source is only accepted for a multicast group.
+            const std::string ADDRESS{(commandlineArguments.count("ncom_ip") == 0) ? "0.0.0.0" : commandlineArguments["ncom_ip"]};
+            const std::string SOURCE{(commandlineArguments.count("ncom_source") == 0) ? "" : "@" + commandlineArguments["ncom_source"]};
+            units = NCOMUDPReceiver::parseUnits(ADDRESS + SOURCE + ":" + commandlineArguments["ncom_port"] + ":" + std::to_string(ID));
+            if (units.empty()) {
+                std::cerr << argv[0] << ": invalid --ncom_ip, --ncom_source, or --ncom_port." << std::endl;
+                return 1;
+            }
+        }
+        if (0 != commandlineArguments.count("ncom_iface")) {
+            for (auto &unit : units) {
+                unit.interfaceAddress = commandlineArguments["ncom_iface"];
+            }
+        }
 
-                opendlv::proxy::GeodeticWgs84Reading msg3 = retVal.second.position;
-                od4Session.send(msg3, sampleTime, senderStamp);
+        // Optionally, forward the received datagrams untouched.
+        std::unique_ptr<NCOMRelay> tee;
+        if (0 != commandlineArguments.count("ncom_tee")) {
+            // Only datagrams can be forwarded untouched.
+            if ( (0 != commandlineArguments.count("ncom_serial")) || (0 != commandlineArguments.count("ncom_tcp")) || (0 != commandlineArguments.count("ncom_file")) ) {
+                std::cerr << argv[0] << ": --ncom_tee requires UDP sockets or --ncom_capture." << std::endl;
+                return 1;
+            }
+            tee.reset(new NCOMRelay(commandlineArguments["ncom_tee"]));
+            if (!tee->isValid()) {
+                std::cerr << argv[0] << ": invalid --ncom_tee." << std::endl;
+                return 1;
+            }
+        }
 
-                opendlv::proxy::GeodeticHeadingReading msg4 = retVal.second.heading;
-                od4Session.send(msg4, sampleTime, senderStamp);
+        // Optionally, record the received packets as they are.
+        std::unique_ptr<NCOMRecorder> recorder;
+        if (0 != commandlineArguments.count("ncom_record")) {
+            const uint64_t RECORD_SIZE{(commandlineArguments["ncom_record_size"].size() != 0) ? std::stoull(commandlineArguments["ncom_record_size"]) : 1024};
+            const int64_t RECORD_SYNC{(commandlineArguments["ncom_record_sync"].size() != 0) ? std::stoll(commandlineArguments["ncom_record_sync"]) : 1000};
+            recorder.reset(new NCOMRecorder(commandlineArguments["ncom_record"], RECORD_SIZE * 1024 * 1024, std::chrono::milliseconds(RECORD_SYNC)));
+            if (!recorder->isValid()) {
+                std::cerr << argv[0] << ": invalid --ncom_record." << std::endl;
+                return 1;
+            }
+        }
 
-                opendlv::proxy::GroundSpeedReading msg5 = retVal.second.speed;
-                od4Session.send(msg5, sampleTime, senderStamp);
+        // Optionally, serve compact records to consumers on this host.
+        std::unique_ptr<NavStateServer> local;
+        if (0 != commandlineArguments.count("local_socket")) {
+            local.reset(new NavStateServer(commandlineArguments["local_socket"]));
+            if (!local->isValid()) {
+                std::cerr << argv[0] << ": invalid --local_socket." << std::endl;
+                return 1;
+            }
+        }
 
-                opendlv::proxy::AltitudeReading msg6 = retVal.second.altitude;
-                od4Session.send(msg6, sampleTime, senderStamp);
+        // Optionally, export the latest state of each unit in shared memory.
+        std::unique_ptr<SharedNavState> shared;
+        if (0 != commandlineArguments.count("shm_nav_state")) {
+            shared.reset(new SharedNavState(commandlineArguments["shm_nav_state"], true));
+            if (!shared->isValid()) {
+                std::cerr << argv[0] << ": invalid --shm_nav_state." << std::endl;
+                return 1;
+            }
+        }
 
-                opendlv::logic::sensation::Geolocation msg7 = retVal.second.geolocation;
-                od4Session.send(msg7, sampleTime, senderStamp);
+        // Optionally, also export the recent states of each unit to look them up by time.
+        std::unique_ptr<SharedNavStateHistory> history;
+        if (0 != commandlineArguments.count("shm_history")) {
+            const std::string SHM_HISTORY{commandlineArguments["shm_history"]};
+            const std::string::size_type COLON{SHM_HISTORY.find(':')};
+            const float SECONDS{(std::string::npos != COLON) ? std::stof(SHM_HISTORY.substr(COLON + 1)) : 10.0f};
+            // Size the ring for the highest NCOM output rate of 250 Hz unless the units' rate is given.
+            const float HISTORY_RATE{(commandlineArguments["ncom_rate"].size() != 0) ? NCOM_RATE : 250.0f};
+            if ( (0.0f < SECONDS) && (0.0f < HISTORY_RATE) && (3600.0f > SECONDS) ) {
+                history.reset(new SharedNavStateHistory(SHM_HISTORY.substr(0, COLON), static_cast<uint32_t>(std::ceil(SECONDS * HISTORY_RATE)), static_cast<uint32_t>(units.size())));
+            }
+            if (!history || !history->isValid()) {
+                std::cerr << argv[0] << ": invalid --shm_history." << std::endl;
+                return 1;
+            }
+        }
 
-                // Print values on console.
-                if (VERBOSE) {
-                    {
-                        std::stringstream buffer;
-                        msg1.accept([](uint32_t, const std::string &, const std::string &) {},
-                                   [&buffer](uint32_t, std::string &&, std::string &&n, auto v) { buffer << n << " = " << v << '\n'; },
-                                   []() {});
-                        std::cout << buffer.str() << std::endl;
-                    }
-                    {
-                        std::stringstream buffer;
-                        msg2.accept([](uint32_t, const std::string &, const std::string &) {},
-                                   [&buffer](uint32_t, std::string &&, std::string &&n, auto v) { buffer << n << " = " << v << '\n'; },
-                                   []() {});
-                        std::cout << buffer.str() << std::endl;
-                    }
-                    {
-                        std::stringstream buffer;
-                        msg3.accept([](uint32_t, const std::string &, const std::string &) {},
-                                   [&buffer](uint32_t, std::string &&, std::string &&n, auto v) { buffer << n << " = " << v << '\n'; },
-                                   []() {});
-                        std::cout << buffer.str() << std::endl;
-                    }
-                    {
-                        std::stringstream buffer;
-                        msg4.accept([](uint32_t, const std::string &, const std::string &) {},
-                                   [&buffer](uint32_t, std::string &&, std::string &&n, auto v) { buffer << n << " = " << v << '\n'; },
-                                   []() {});
-                        std::cout << buffer.str() << std::endl;
-                    }
-                    {
-                        std::stringstream buffer;
-                        msg5.accept([](uint32_t, const std::string &, const std::string &) {},
-                                   [&buffer](uint32_t, std::string &&, std::string &&n, auto v) { buffer << n << " = " << v << '\n'; },
-                                   []() {});
-                        std::cout << buffer.str() << std::endl;
-                    }
-                    {
-                        std::stringstream buffer;
-                        msg6.accept([](uint32_t, const std::string &, const std::string &) {},
-                                   [&buffer](uint32_t, std::string &&, std::string &&n, auto v) { buffer << n << " = " << v << '\n'; },
-                                   []() {});
-                        std::cout << buffer.str() << std::endl;
-                    }
-                    {
-                        std::stringstream buffer;
-                        msg7.accept([](uint32_t, const std::string &, const std::string &) {},
-                                   [&buffer](uint32_t, std::string &&, std::string &&n, auto v) { buffer << n << " = " << v << '\n'; },
-                                   []() {});
-                        std::cout << buffer.str() << std::endl;
+        // Publish the decoded messages of one NCOM packet.
+        auto publish = [&toOD4, &routes, &local, &shared, &history, VERBOSE](const NavState &state) {
+            toOD4.publish(state);
+            for (auto &route : routes) {
+                route->publish(state);
+            }
+            if (local || shared || history) {
+                const NavStateRecord RECORD{state.record()};
+                if (shared) {
+                    shared->write(RECORD);
+                }
+                if (history) {
+                    history->write(RECORD);
+                }
+                if (local) {
+                    local->add(RECORD);
+                }
+            }
+
+            // Print values on console.
+            if (VERBOSE) {
+                opendlv::proxy::AccelerationReading msg1 = state.messages.acceleration;
+                opendlv::proxy::AngularVelocityReading msg2 = state.messages.angularVelocity;
+                opendlv::proxy::GeodeticWgs84Reading msg3 = state.messages.position;
+                opendlv::proxy::GeodeticHeadingReading msg4 = state.messages.heading;
+                opendlv::proxy::GroundSpeedReading msg5 = state.messages.speed;
+                opendlv::proxy::AltitudeReading msg6 = state.messages.altitude;
+                opendlv::logic::sensation::Geolocation msg7 = state.messages.geolocation;
+                {
+                    std::stringstream buffer;
+                    msg1.accept([](uint32_t, const std::string &, const std::string &) {},
+                               [&buffer](uint32_t, std::string &&, std::string &&n, auto v) { buffer << n << " = " << v << '\n'; },
+                               []() {});
+                    std::cout << buffer.str() << std::endl;
+                }
+                {
+                    std::stringstream buffer;
+                    msg2.accept([](uint32_t, const std::string &, const std::string &) {},
+                               [&buffer](uint32_t, std::string &&, std::string &&n, auto v) { buffer << n << " = " << v << '\n'; },
+                               []() {});
+                    std::cout << buffer.str() << std::endl;
+                }
+                {
+                    std::stringstream buffer;
+                    msg3.accept([](uint32_t, const std::string &, const std::string &) {},
+                               [&buffer](uint32_t, std::string &&, std::string &&n, auto v) { buffer << n << " = " << v << '\n'; },
+                               []() {});
+                    std::cout << buffer.str() << std::endl;
+                }
+                {
+                    std::stringstream buffer;
+                    msg4.accept([](uint32_t, const std::string &, const std::string &) {},
+                               [&buffer](uint32_t, std::string &&, std::string &&n, auto v) { buffer << n << " = " << v << '\n'; },
+                               []() {});
+                    std::cout << buffer.str() << std::endl;
+                }
+                {
+                    std::stringstream buffer;
+                    msg5.accept([](uint32_t, const std::string &, const std::string &) {},
+                               [&buffer](uint32_t, std::string &&, std::string &&n, auto v) { buffer << n << " = " << v << '\n'; },
+                               []() {});
+                    std::cout << buffer.str() << std::endl;
+                }
+                {
+                    std::stringstream buffer;
+                    msg6.accept([](uint32_t, const std::string &, const std::string &) {},
+                               [&buffer](uint32_t, std::string &&, std::string &&n, auto v) { buffer << n << " = " << v << '\n'; },
+                               []() {});
+                    std::cout << buffer.str() << std::endl;
+                }
+                {
+                    std::stringstream buffer;
+                    msg7.accept([](uint32_t, const std::string &, const std::string &) {},
+                               [&buffer](uint32_t, std::string &&, std::string &&n, auto v) { buffer << n << " = " << v << '\n'; },
+                               []() {});
+                    std::cout << buffer.str() << std::endl;
+                }
+            }
+        };
+
+        // Send what was collected for local consumers.
+        auto endOfBatch = [&local]() {
+            if (local) {
+                local->flush();
+            }
+        };
+
+        // Optionally, hand over decoded packets to a separate publishing thread.
+        const uint32_t PUBLISHER_QUEUE{(commandlineArguments.count("publisher_queue") != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["publisher_queue"])) : 0};
+        OverflowPolicy publisherOverflow{OverflowPolicy::DROP_OLDEST};
+        if (commandlineArguments["publisher_overflow"] == "drop_newest") {
+            publisherOverflow = OverflowPolicy::DROP_NEWEST;
+        } else if (commandlineArguments["publisher_overflow"] == "keep_latest") {
+            publisherOverflow = OverflowPolicy::KEEP_LATEST;
+            // The latest entry would be that of any unit, not of each one.
+            if (1 < units.size()) {
+                std::cerr << argv[0] << ": --publisher_overflow=keep_latest requires a single unit." << std::endl;
+                return 1;
+            }
+        } else if (commandlineArguments["publisher_overflow"] == "block") {
+            publisherOverflow = OverflowPolicy::BLOCK;
+        }
+        std::unique_ptr<SPSCRing<NavState>> publisherQueue;
+        std::atomic<bool> publisherRunning{false};
+        std::thread publisher;
+        if (0 < PUBLISHER_QUEUE) {
+            publisherQueue.reset(new SPSCRing<NavState>(PUBLISHER_QUEUE, publisherOverflow));
+            publisherRunning.store(true);
+            publisher = std::thread([&queue = *publisherQueue, &publisherRunning, &publish, &endOfBatch]() {
+                using namespace std::literals::chrono_literals;
+                NavState state;
+                while (publisherRunning.load()) {
+                    if (queue.waitAndPop(state, 100ms)) {
+                        // Everything waiting is one batch.
+                        do {
+                            publish(state);
+                        } while (queue.pop(state));
+                        endOfBatch();
                     }
                 }
+                // Publish what is left, e.g., at the end of a file.
+                while (queue.pop(state)) {
+                    publish(state);
+                }
+                endOfBatch();
+            });
+        }
+
+        // Each unit has its own decoder state as the GPS minutes are tracked per unit.
+        std::vector<std::unique_ptr<NCOMDecoder>> decoders;
+        for (std::size_t i{0}; i < units.size(); i++) {
+            decoders.emplace_back(new NCOMDecoder());
+        }
+
+        auto onDatagram = [&units, &decoders, &queue = publisherQueue, &publish, &endOfBatch, &toOD4, &recorder, RAW, DONT_USE_GPSTIME](std::size_t unit, const char *data, std::size_t length, const std::chrono::system_clock::time_point &tp) {
+            // Only copied here; written to storage from the recorder's thread.
+            if (recorder) {
+                recorder->add(data, length, units[unit].senderStamp, tp);
+            }
+
+            // Pass the packet on without decoding it.
+            if (RAW) {
+                toOD4.publishRaw(data, length, cluon::time::convert(tp), units[unit].senderStamp);
+                return;
             }
-        });
+
+            auto retVal = decoders[unit]->decode(data, length);
+            if (retVal.first) {
+                NavState state;
+                state.received = cluon::time::convert(tp);
+                state.sampleTime = state.received;
+                state.senderStamp = units[unit].senderStamp;
+                state.messages = retVal.second;
+
+                // Check whether we should use the OxTS' GPS time for sample time
+                // and whether we have a valid time stamp.
+                if ( !DONT_USE_GPSTIME && (0 < cluon::time::toMicroseconds(retVal.second.sampleTime)) ) {
+                    state.sampleTime = retVal.second.sampleTime;
+                }
+
+                if (queue) {
+                    queue->push(state);
+                } else {
+                    publish(state);
+                    endOfBatch();
+                }
+            }
+        };
+
+        // Either read NCOM from a file/pipe, a serial port, or a TCP relay,
+        // capture the datagrams from a network interface (e.g., a mirrored
+        // port), or receive them via regular UDP sockets.
+        std::unique_ptr<NCOMFileReader> fromFile;
+        std::unique_ptr<NCOMPacketCapture> fromCapture;
+        std::unique_ptr<NCOMSerialReceiver> fromSerial;
+        std::unique_ptr<NCOMTCPReceiver> fromTCP;
+        std::unique_ptr<NCOMUDPReceiver> fromSockets;
+        if (0 != commandlineArguments.count("ncom_file")) {
+            const NCOMFileReader::Pacing PACING{(0 != commandlineArguments.count("gps_paced")) ? NCOMFileReader::Pacing::GPS_TIME : NCOMFileReader::Pacing::MAX_SPEED};
+            fromFile.reset(new NCOMFileReader(commandlineArguments["ncom_file"], PACING, onDatagram));
+        } else if (0 != commandlineArguments.count("ncom_tcp")) {
+            const std::string HOST_PORT{commandlineArguments["ncom_tcp"]};
+            const std::string::size_type COLON{HOST_PORT.rfind(':')};
+            if (std::string::npos != COLON) {
+                fromTCP.reset(new NCOMTCPReceiver(HOST_PORT.substr(0, COLON), static_cast<uint16_t>(std::stoi(HOST_PORT.substr(COLON + 1))), onDatagram));
+            }
+        } else if (0 != commandlineArguments.count("ncom_serial")) {
+            const uint32_t BAUD{(commandlineArguments["baud"].size() != 0) ? static_cast<uint32_t>(std::stoul(commandlineArguments["baud"])) : 115200};
+            fromSerial.reset(new NCOMSerialReceiver(commandlineArguments["ncom_serial"], BAUD, onDatagram));
+        } else if (0 != commandlineArguments.count("ncom_capture")) {
+            fromCapture.reset(new NCOMPacketCapture(commandlineArguments["ncom_capture"], units, onDatagram, tee.get()));
+        } else {
+            const NCOMUDPReceiver::Backend BACKEND{(commandlineArguments["ncom_backend"] == "io_uring") ? NCOMUDPReceiver::Backend::IO_URING : NCOMUDPReceiver::Backend::EPOLL};
+            fromSockets.reset(new NCOMUDPReceiver(units, onDatagram, BACKEND, tee.get()));
+        }
+        // Only startup errors are errors; a short file or stdin may already
+        // be read completely.
+        const bool VALID{(fromFile && fromFile->isValid()) || (fromCapture && fromCapture->isValid()) || (fromSerial && fromSerial->isValid()) || (fromTCP && fromTCP->isValid()) || (fromSockets && fromSockets->isValid())};
+        if (!VALID) {
+            std::cerr << argv[0] << ": could not receive from the given OxTS unit(s)." << std::endl;
+            retCode = 1;
+        }
+        auto isReceiving = [&fromFile, &fromCapture, &fromSerial, &fromTCP, &fromSockets]() {
+            return (fromFile && fromFile->isRunning()) || (fromCapture && fromCapture->isRunning()) || (fromSerial && fromSerial->isRunning()) || (fromTCP && fromTCP->isRunning()) || (fromSockets && fromSockets->isRunning());
+        };
 
         // Just sleep as this microservice is data driven.
         using namespace std::literals::chrono_literals;
-        while (od4.isRunning()) {
+        std::vector<uint64_t> reportedDrops(units.size(), 0);
+        uint64_t reportedRecorderDrops{0};
+        while (od4.isRunning() && isReceiving()) {
             std::this_thread::sleep_for(1s);
+            if (SUBSCRIPTIONS) {
+                const uint32_t EXPIRED{toOD4.expireSubscriptions()};
+                if (VERBOSE && (0 < EXPIRED)) {
+                    std::cerr << argv[0] << ": " << EXPIRED << " subscriptions expired." << std::endl;
+                }
+            }
+            for (std::size_t unit{0}; fromSockets && (unit < units.size()); unit++) {
+                const NCOMUDPReceiver::Statistics STATISTICS{fromSockets->statistics(unit)};
+                std::stringstream sstr;
+                sstr << "datagrams=" << STATISTICS.datagrams << ",drops=" << STATISTICS.drops << ",rate=" << STATISTICS.rate << ",receiveBuffer=" << STATISTICS.receiveBuffer;
+                if (STATISTICS.drops > reportedDrops[unit]) {
+                    std::cerr << argv[0] << ": kernel dropped " << (STATISTICS.drops - reportedDrops[unit]) << " datagrams from unit " << units[unit].senderStamp << " (" << sstr.str() << ")." << std::endl;
+                    reportedDrops[unit] = STATISTICS.drops;
+                } else if (VERBOSE) {
+                    std::cerr << argv[0] << ": unit " << units[unit].senderStamp << ": " << sstr.str() << std::endl;
+                }
+                if (METRICS) {
+                    // Code carries the number of dropped datagrams saturated to int32.
+                    opendlv::system::NetworkStatusMessage msg;
+                    msg.code(static_cast<int32_t>((STATISTICS.drops < 0x7FFFFFFF) ? STATISTICS.drops : 0x7FFFFFFF));
+                    msg.description(sstr.str());
+                    od4.send(msg, cluon::time::now(), units[unit].senderStamp);
+                }
+            }
+            if (VERBOSE && tee) {
+                std::cerr << argv[0] << ": forwarded " << tee->forwarded() << " datagrams, dropped " << tee->dropped() << " so far." << std::endl;
+            }
+            if (recorder && (VERBOSE || (recorder->dropped() > reportedRecorderDrops))) {
+                reportedRecorderDrops = recorder->dropped();
+                std::cerr << argv[0] << ": recorded " << recorder->recorded() << " packets, dropped " << reportedRecorderDrops << " so far." << std::endl;
+            }
+            if (VERBOSE && local) {
+                std::cerr << argv[0] << ": serving " << local->subscribers() << " local subscribers, dropped " << local->dropped() << " slow ones so far." << std::endl;
+            }
+            if (VERBOSE && publisherQueue) {
+                std::cerr << argv[0] << ": publisher queue holds " << publisherQueue->size() << "/" << publisherQueue->capacity() << " entries (at most " << publisherQueue->highWaterMark() << "), dropped " << publisherQueue->dropped() << ", blocked " << publisherQueue->blocked() << " times so far." << std::endl;
+            }
+        }
+
+        // Stop the inputs first as they might wait for the publisher (block).
+        fromFile.reset();
+        fromCapture.reset();
+        fromSerial.reset();
+        fromTCP.reset();
+        fromSockets.reset();
+        if (publisher.joinable()) {
+            publisherRunning.store(false);
+            publisherQueue->wakeUp();
+            publisher.join();
         }
     }
     return retCode;
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SEQLOCK_RECORD
+#define SEQLOCK_RECORD
+
+#include "nav-state-record.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <array>
+#include <atomic>
+
+/**
+ * NavStateRecord protected by a seqlock for one writer and any number of
+ * readers, also across processes when placed in shared memory: The writer
+ * makes the sequence odd, stores the record, and sets the new even
+ * sequence; a reader's copy is valid if it saw the same even sequence
+ * before and after copying. The record is stored as relaxed atomic 32-bit
+ * words so that concurrent copies are well-defined and lock-free on all
+ * platforms. A sequence of 0 means that nothing was written yet; zeroed
+ * memory is a valid, empty SeqLockRecord.
+ */
+class SeqLockRecord {
+   private:
+    // Enumerator rather than static member, so it needs no definition.
+    enum : uint32_t { WORDS = sizeof(NavStateRecord) / sizeof(uint32_t) };
+
+   public:
+    /**
+     * Writer: Store a record.
+     *
+     * @param record Record to store.
+     * @param sequence New even sequence other than 0 to identify this record.
+     */
+    void store(const NavStateRecord &record, uint32_t sequence) noexcept {
+        std::array<uint32_t, WORDS> words;
+        std::memcpy(words.data(), &record, sizeof(record));
+        m_sequence.store(sequence - 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (uint32_t i{0}; i < WORDS; i++) {
+            m_words[i].store(words[i], std::memory_order_relaxed);
+        }
+        m_sequence.store(sequence, std::memory_order_release);
+    }
+
+    /**
+     * Reader: Try once to copy the record.
+     *
+     * @param record Record to fill.
+     * @return Sequence of the copied record, or 0 if nothing was written yet
+     *         or the record was being written meanwhile.
+     */
+    uint32_t tryLoad(NavStateRecord &record) const noexcept {
+        const uint32_t BEFORE{m_sequence.load(std::memory_order_acquire)};
+        if ( (0 == BEFORE) || (0 != (BEFORE & 1)) ) {
+            return 0;
+        }
+        std::array<uint32_t, WORDS> words;
+        for (uint32_t i{0}; i < WORDS; i++) {
+            words[i] = m_words[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (BEFORE != m_sequence.load(std::memory_order_relaxed)) {
+            return 0;
+        }
+        std::memcpy(static_cast<void *>(&record), words.data(), sizeof(record));
+        return BEFORE;
+    }
+
+    /**
+     * @return Sequence of the last completely stored record, or an odd one while storing.
+     */
+    uint32_t sequence() const noexcept {
+        return m_sequence.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @param sequence Current sequence.
+     * @return Next even sequence after the given one, skipping 0.
+     */
+    static uint32_t next(uint32_t sequence) noexcept {
+        const uint32_t NEXT{(sequence | 1) + 1};
+        return (0 == NEXT) ? 2 : NEXT;
+    }
+
+   private:
+    std::atomic<uint32_t> m_sequence;
+    std::array<std::atomic<uint32_t>, WORDS> m_words;
+};
+
+static_assert(std::is_standard_layout<SeqLockRecord>::value, "SeqLockRecord is placed in shared memory.");
+
+#endif
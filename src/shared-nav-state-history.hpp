@@ -0,0 +1,402 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SHARED_NAV_STATE_HISTORY
+#define SHARED_NAV_STATE_HISTORY
+
+#include "cluon-complete.hpp"
+#include "nav-state-record.hpp"
+#include "seqlock-record.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Recent NavStateRecords per unit in a named cluon::SharedMemory segment,
+ * e.g., to look up the pose at the time a camera frame was exposed. Each
+ * unit has a ring of a fixed number of records in the order they were
+ * written; every entry is a SeqLockRecord whose sequence identifies the
+ * record's position in the stream, so that a reader detects entries that
+ * were overwritten while it was searching. Readers binary-search either by
+ * sample time or by host time of reception and interpolate between the two
+ * neighbouring records without any system call or lock.
+ * The writer must be used from one thread; readers from any thread or process.
+ */
+class SharedNavStateHistory {
+   private:
+    SharedNavStateHistory(const SharedNavStateHistory &) = delete;
+    SharedNavStateHistory(SharedNavStateHistory &&)      = delete;
+    SharedNavStateHistory &operator=(const SharedNavStateHistory &) = delete;
+    SharedNavStateHistory &operator=(SharedNavStateHistory &&) = delete;
+
+   public:
+    // Enumerators rather than static members, so they need no definition.
+    enum : uint32_t {
+        MAX_UNITS = 16,
+        // Incremented with every change of the layout or of NavStateRecord.
+        VERSION = 1,
+    };
+
+    enum class TimeBase : uint8_t {
+        SAMPLE_TIME,
+        RECEIVED,
+    };
+
+   private:
+    enum : uint32_t { MAX_RETRIES = 100 };
+
+    class Header {
+       public:
+        std::atomic<uint32_t> version;
+        std::atomic<uint32_t> capacity;
+        std::atomic<uint32_t> maxUnits;
+        std::atomic<uint32_t> numberOfUnits;
+    };
+
+    class Unit {
+       public:
+        std::atomic<uint32_t> senderStamp;
+        // Position of the next record in the stream, wrapping around.
+        std::atomic<uint32_t> head;
+        // Number of records in the ring, up to its capacity.
+        std::atomic<uint32_t> size;
+    };
+
+   public:
+    /**
+     * Constructor for readers: Attach to an existing segment.
+     *
+     * @param name Name of the shared memory segment.
+     */
+    explicit SharedNavStateHistory(const std::string &name) noexcept {
+        try {
+            m_sharedMemory.reset(new cluon::SharedMemory(name, 0));
+        } catch (...) {
+            return;
+        }
+        if (!m_sharedMemory->valid() || (sizeof(Header) > m_sharedMemory->size()) || !isAligned()) {
+            return;
+        }
+        const Header *header{reinterpret_cast<const Header *>(m_sharedMemory->data())};
+        if (VERSION != header->version.load(std::memory_order_acquire)) {
+            return;
+        }
+        const uint32_t CAPACITY{header->capacity.load(std::memory_order_relaxed)};
+        const uint32_t MAX{header->maxUnits.load(std::memory_order_relaxed)};
+        if ( (0 == CAPACITY) || (0 != (CAPACITY & (CAPACITY - 1))) || (0 == MAX) || (MAX_UNITS < MAX)
+             || (sizeOf(CAPACITY, MAX) > m_sharedMemory->size()) ) {
+            return;
+        }
+        attach(CAPACITY, MAX);
+    }
+
+    /**
+     * Constructor for the writer: Create the segment, replacing a stale one.
+     *
+     * @param name Name of the shared memory segment.
+     * @param capacity Records per unit, rounded up to a power of two.
+     * @param maxUnits Number of units to keep records of, up to MAX_UNITS.
+     */
+    SharedNavStateHistory(const std::string &name, uint32_t capacity, uint32_t maxUnits) noexcept
+        : m_writer(true) {
+        uint32_t rounded{2};
+        while ( (rounded < capacity) && (rounded <= (std::numeric_limits<uint32_t>::max() / 2)) ) {
+            rounded *= 2;
+        }
+        if ( (rounded < capacity) || (0 == maxUnits) || (MAX_UNITS < maxUnits)
+             || (std::numeric_limits<uint32_t>::max() < sizeOf(rounded, maxUnits)) ) {
+            return;
+        }
+        try {
+            m_sharedMemory.reset(new cluon::SharedMemory(name, static_cast<uint32_t>(sizeOf(rounded, maxUnits))));
+        } catch (...) {
+            return;
+        }
+        if (!m_sharedMemory->valid() || (sizeOf(rounded, maxUnits) > m_sharedMemory->size()) || !isAligned()) {
+            return;
+        }
+        // Readers accept the segment only once it is initialized.
+        std::memset(m_sharedMemory->data(), 0, static_cast<std::size_t>(sizeOf(rounded, maxUnits)));
+        attach(rounded, maxUnits);
+        m_header->capacity.store(rounded, std::memory_order_relaxed);
+        m_header->maxUnits.store(maxUnits, std::memory_order_relaxed);
+        m_header->version.store(VERSION, std::memory_order_release);
+    }
+    ~SharedNavStateHistory() = default;
+
+    /**
+     * @return true if the segment could be created or attached to.
+     */
+    bool isValid() const noexcept {
+        return nullptr != m_header;
+    }
+
+    /**
+     * @return Records per unit.
+     */
+    uint32_t capacity() const noexcept {
+        return m_capacity;
+    }
+
+    /**
+     * Writer: Append a record to the ring of its unit, overwriting its
+     * oldest record once the ring is full; units beyond the maximum
+     * number of units are ignored.
+     *
+     * @param record Record to append.
+     */
+    void write(const NavStateRecord &record) noexcept {
+        if (!m_writer || (nullptr == m_header)) {
+            return;
+        }
+        const int32_t UNIT{unitOf(record.senderStamp)};
+        if (0 > UNIT) {
+            return;
+        }
+        Unit &unit{m_units[UNIT]};
+        const uint32_t HEAD{unit.head.load(std::memory_order_relaxed)};
+        const uint32_t SIZE{unit.size.load(std::memory_order_relaxed)};
+        entry(static_cast<uint32_t>(UNIT), HEAD).store(record, sequenceOf(HEAD));
+        unit.size.store((SIZE < m_capacity) ? SIZE + 1 : SIZE, std::memory_order_relaxed);
+        unit.head.store(HEAD + 1, std::memory_order_release);
+    }
+
+    /**
+     * Reader: Time span of the records of a unit.
+     *
+     * @param senderStamp Sender stamp of the unit.
+     * @param timeBase Time stamps to report.
+     * @param oldest Time of the oldest record in microseconds.
+     * @param newest Time of the newest record in microseconds.
+     * @return true if the unit has records.
+     */
+    bool span(uint32_t senderStamp, TimeBase timeBase, int64_t &oldest, int64_t &newest) const noexcept {
+        const int32_t UNIT{find(senderStamp)};
+        if (0 > UNIT) {
+            return false;
+        }
+        const Unit &unit{m_units[UNIT]};
+        for (uint32_t retries{0}; retries < MAX_RETRIES; retries++) {
+            const uint32_t HEAD{unit.head.load(std::memory_order_acquire)};
+            const uint32_t SIZE{unit.size.load(std::memory_order_relaxed)};
+            if (0 == SIZE) {
+                return false;
+            }
+            NavStateRecord first;
+            NavStateRecord last;
+            if (load(static_cast<uint32_t>(UNIT), HEAD - 1, last)) {
+                // The oldest record might be overwritten already.
+                for (uint32_t k{0}; k < SIZE; k++) {
+                    if (load(static_cast<uint32_t>(UNIT), HEAD - SIZE + k, first)) {
+                        oldest = timeOf(first, timeBase);
+                        newest = timeOf(last, timeBase);
+                        return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Reader: Record of a unit at a given time, interpolated linearly between
+     * the two neighbouring records; angles are interpolated along the shorter
+     * arc.
+     *
+     * @param senderStamp Sender stamp of the unit.
+     * @param time Time in microseconds since the epoch.
+     * @param timeBase Whether time refers to sample time or to host time of reception.
+     * @param record Record to fill.
+     * @return true if time lies within the records of this unit.
+     */
+    bool at(uint32_t senderStamp, int64_t time, TimeBase timeBase, NavStateRecord &record) const noexcept {
+        const int32_t UNIT{find(senderStamp)};
+        if (0 > UNIT) {
+            return false;
+        }
+        const uint32_t U{static_cast<uint32_t>(UNIT)};
+        const Unit &unit{m_units[U]};
+        for (uint32_t retries{0}; retries < MAX_RETRIES; retries++) {
+            const uint32_t HEAD{unit.head.load(std::memory_order_acquire)};
+            const uint32_t SIZE{unit.size.load(std::memory_order_relaxed)};
+
+            // First record after time; overwritten records count as older.
+            uint32_t low{0};
+            uint32_t high{SIZE};
+            NavStateRecord after;
+            bool haveAfter{false};
+            while (low < high) {
+                const uint32_t MIDDLE{low + (high - low) / 2};
+                NavStateRecord r;
+                if (load(U, HEAD - SIZE + MIDDLE, r) && (time < timeOf(r, timeBase))) {
+                    high = MIDDLE;
+                    after = r;
+                    haveAfter = true;
+                } else {
+                    low = MIDDLE + 1;
+                }
+            }
+            if (0 == low) {
+                // Before the oldest record.
+                return false;
+            }
+            NavStateRecord before;
+            if (!load(U, HEAD - SIZE + low - 1, before)) {
+                // Overwritten while searching.
+                continue;
+            }
+            const int64_t BEFORE{timeOf(before, timeBase)};
+            if (time == BEFORE) {
+                record = before;
+                return true;
+            }
+            if (!haveAfter || (time < BEFORE)) {
+                // After the newest record.
+                return false;
+            }
+            interpolate(before, after, static_cast<double>(time - BEFORE) / static_cast<double>(timeOf(after, timeBase) - BEFORE), record);
+            return true;
+        }
+        return false;
+    }
+
+   private:
+    static uint64_t sizeOf(uint32_t capacity, uint32_t maxUnits) noexcept {
+        return sizeof(Header) + maxUnits * sizeof(Unit) + static_cast<uint64_t>(maxUnits) * capacity * sizeof(SeqLockRecord);
+    }
+
+    // Sequence of a record's position in the stream; positions wrap around
+    // long after the record was overwritten.
+    static uint32_t sequenceOf(uint32_t position) noexcept {
+        return SeqLockRecord::next(2 * position);
+    }
+
+    static int64_t timeOf(const NavStateRecord &record, TimeBase timeBase) noexcept {
+        return (TimeBase::SAMPLE_TIME == timeBase) ? record.sampleTime : record.received;
+    }
+
+    // Angle in [-pi, pi] like the decoded ones.
+    static float wrap(double angle) noexcept {
+        return static_cast<float>(std::remainder(angle, 2.0 * M_PI));
+    }
+
+    static void interpolate(const NavStateRecord &a, const NavStateRecord &b, double f, NavStateRecord &r) noexcept {
+        auto linear = [f](float x, float y) {
+            return static_cast<float>(x + (static_cast<double>(y) - x) * f);
+        };
+        auto angular = [f](float x, float y) {
+            return wrap(x + std::remainder(static_cast<double>(y) - x, 2.0 * M_PI) * f);
+        };
+        r = a;
+        r.sampleTime = a.sampleTime + std::llround(static_cast<double>(b.sampleTime - a.sampleTime) * f);
+        r.received = a.received + std::llround(static_cast<double>(b.received - a.received) * f);
+        r.latitude = a.latitude + (b.latitude - a.latitude) * f;
+        r.longitude = a.longitude + (b.longitude - a.longitude) * f;
+        r.altitude = linear(a.altitude, b.altitude);
+        r.heading = angular(a.heading, b.heading);
+        r.pitch = angular(a.pitch, b.pitch);
+        r.roll = angular(a.roll, b.roll);
+        r.velocityNorth = linear(a.velocityNorth, b.velocityNorth);
+        r.velocityEast = linear(a.velocityEast, b.velocityEast);
+        r.velocityDown = linear(a.velocityDown, b.velocityDown);
+        r.groundSpeed = linear(a.groundSpeed, b.groundSpeed);
+        r.accelerationX = linear(a.accelerationX, b.accelerationX);
+        r.accelerationY = linear(a.accelerationY, b.accelerationY);
+        r.accelerationZ = linear(a.accelerationZ, b.accelerationZ);
+        r.angularVelocityX = linear(a.angularVelocityX, b.angularVelocityX);
+        r.angularVelocityY = linear(a.angularVelocityY, b.angularVelocityY);
+        r.angularVelocityZ = linear(a.angularVelocityZ, b.angularVelocityZ);
+    }
+
+    bool isAligned() const noexcept {
+        return 0 == (reinterpret_cast<std::uintptr_t>(m_sharedMemory->data()) % alignof(SeqLockRecord));
+    }
+
+    void attach(uint32_t capacity, uint32_t maxUnits) noexcept {
+        char *data{m_sharedMemory->data()};
+        m_capacity = capacity;
+        m_maxUnits = maxUnits;
+        m_header = reinterpret_cast<Header *>(data);
+        m_units = reinterpret_cast<Unit *>(data + sizeof(Header));
+        m_entries = reinterpret_cast<SeqLockRecord *>(data + sizeof(Header) + maxUnits * sizeof(Unit));
+    }
+
+    SeqLockRecord &entry(uint32_t unit, uint32_t position) const noexcept {
+        return m_entries[static_cast<std::size_t>(unit) * m_capacity + (position & (m_capacity - 1))];
+    }
+
+    // Reader: Copy the record at a position unless it was overwritten.
+    bool load(uint32_t unit, uint32_t position, NavStateRecord &record) const noexcept {
+        return sequenceOf(position) == entry(unit, position).tryLoad(record);
+    }
+
+    // Reader: Index of a unit.
+    int32_t find(uint32_t senderStamp) const noexcept {
+        if (nullptr == m_header) {
+            return -1;
+        }
+        uint32_t units{m_header->numberOfUnits.load(std::memory_order_acquire)};
+        units = (m_maxUnits < units) ? m_maxUnits : units;
+        for (uint32_t u{0}; u < units; u++) {
+            if (senderStamp == m_units[u].senderStamp.load(std::memory_order_relaxed)) {
+                return static_cast<int32_t>(u);
+            }
+        }
+        return -1;
+    }
+
+    // Writer: Index of a unit; new units are announced before their first record.
+    int32_t unitOf(uint32_t senderStamp) noexcept {
+        for (const auto &u : m_unitsWritten) {
+            if (senderStamp == u.first) {
+                return static_cast<int32_t>(u.second);
+            }
+        }
+        const uint32_t UNITS{static_cast<uint32_t>(m_unitsWritten.size())};
+        if (m_maxUnits <= UNITS) {
+            return -1;
+        }
+        try {
+            m_unitsWritten.emplace_back(senderStamp, UNITS);
+        } catch (...) {
+            return -1;
+        }
+        m_units[UNITS].senderStamp.store(senderStamp, std::memory_order_relaxed);
+        m_header->numberOfUnits.store(UNITS + 1, std::memory_order_release);
+        return static_cast<int32_t>(UNITS);
+    }
+
+   private:
+    bool m_writer{false};
+    std::unique_ptr<cluon::SharedMemory> m_sharedMemory{};
+    uint32_t m_capacity{0};
+    uint32_t m_maxUnits{0};
+    Header *m_header{nullptr};
+    Unit *m_units{nullptr};
+    SeqLockRecord *m_entries{nullptr};
+    std::vector<std::pair<uint32_t, uint32_t>> m_unitsWritten{};
+};
+
+#endif
@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SHARED_NAV_STATE
+#define SHARED_NAV_STATE
+
+#include "cluon-complete.hpp"
+#include "nav-state-record.hpp"
+#include "seqlock-record.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Latest NavStateRecord per unit in a named cluon::SharedMemory segment.
+ * Each unit's record is protected by a seqlock (SeqLockRecord); readers
+ * retry if the record was being written meanwhile. Hence, reading needs
+ * neither a system call nor a lock, and a reader can never delay the writer.
+ * The writer must be used from one thread; readers from any thread or process.
+ */
+class SharedNavState {
+   private:
+    SharedNavState(const SharedNavState &) = delete;
+    SharedNavState(SharedNavState &&)      = delete;
+    SharedNavState &operator=(const SharedNavState &) = delete;
+    SharedNavState &operator=(SharedNavState &&) = delete;
+
+   public:
+    // Enumerators rather than static members, so they need no definition.
+    enum : uint32_t {
+        MAX_UNITS = 16,
+        // Incremented with every change of the layout or of NavStateRecord.
+        VERSION = 2,
+    };
+
+   private:
+    enum : uint32_t { MAX_RETRIES = 1000 };
+
+    class Slot {
+       public:
+        std::atomic<uint32_t> senderStamp;
+        SeqLockRecord record;
+    };
+
+    class Layout {
+       public:
+        std::atomic<uint32_t> version;
+        std::atomic<uint32_t> numberOfUnits;
+        std::array<Slot, MAX_UNITS> slots;
+    };
+
+   public:
+    /**
+     * Constructor.
+     *
+     * @param name Name of the shared memory segment.
+     * @param writer If true, the segment is created (replacing a stale one);
+     *               otherwise, an existing segment is attached to.
+     */
+    explicit SharedNavState(const std::string &name, bool writer = false) noexcept
+        : m_writer(writer) {
+        try {
+            m_sharedMemory.reset(new cluon::SharedMemory(name, writer ? static_cast<uint32_t>(sizeof(Layout)) : 0));
+        } catch (...) {
+            return;
+        }
+        if (!m_sharedMemory->valid() || (sizeof(Layout) > m_sharedMemory->size())
+            || (0 != (reinterpret_cast<std::uintptr_t>(m_sharedMemory->data()) % alignof(Layout)))) {
+            return;
+        }
+        m_layout = reinterpret_cast<Layout *>(m_sharedMemory->data());
+        if (m_writer) {
+            // Readers accept the segment only once it is initialized.
+            std::memset(m_sharedMemory->data(), 0, sizeof(Layout));
+            m_layout->version.store(VERSION, std::memory_order_release);
+        } else if (VERSION != m_layout->version.load(std::memory_order_acquire)) {
+            m_layout = nullptr;
+        }
+    }
+    ~SharedNavState() = default;
+
+    /**
+     * @return true if the segment could be created or attached to.
+     */
+    bool isValid() const noexcept {
+        return nullptr != m_layout;
+    }
+
+    /**
+     * Writer: Replace the latest record of its unit; units beyond
+     * MAX_UNITS are ignored.
+     *
+     * @param record Record to publish.
+     */
+    void write(const NavStateRecord &record) noexcept {
+        if (!m_writer || (nullptr == m_layout)) {
+            return;
+        }
+        Slot *slot{slotOf(record.senderStamp)};
+        if (nullptr == slot) {
+            return;
+        }
+        slot->record.store(record, SeqLockRecord::next(slot->record.sequence()));
+    }
+
+    /**
+     * Reader: Copy the latest record of a unit.
+     *
+     * @param senderStamp Sender stamp of the unit.
+     * @param record Record to fill.
+     * @return true if a consistent record of this unit was copied.
+     */
+    bool read(uint32_t senderStamp, NavStateRecord &record) const noexcept {
+        if (nullptr == m_layout) {
+            return false;
+        }
+        uint32_t units{m_layout->numberOfUnits.load(std::memory_order_acquire)};
+        units = (MAX_UNITS < units) ? static_cast<uint32_t>(MAX_UNITS) : units;
+        for (uint32_t u{0}; u < units; u++) {
+            const Slot &slot{m_layout->slots[u]};
+            if (senderStamp != slot.senderStamp.load(std::memory_order_relaxed)) {
+                continue;
+            }
+            for (uint32_t retries{0}; retries < MAX_RETRIES; retries++) {
+                if (0 == slot.record.sequence()) {
+                    // Announced, but nothing written yet.
+                    return false;
+                }
+                if (0 != slot.record.tryLoad(record)) {
+                    return true;
+                }
+            }
+            // The writer might have died while writing.
+            return false;
+        }
+        return false;
+    }
+
+   private:
+    // Writer: Slot of a unit; new units are announced before their first record.
+    Slot *slotOf(uint32_t senderStamp) noexcept {
+        for (const auto &entry : m_slots) {
+            if (senderStamp == entry.first) {
+                return &m_layout->slots[entry.second];
+            }
+        }
+        const uint32_t UNITS{static_cast<uint32_t>(m_slots.size())};
+        if (MAX_UNITS <= UNITS) {
+            return nullptr;
+        }
+        try {
+            m_slots.emplace_back(senderStamp, UNITS);
+        } catch (...) {
+            return nullptr;
+        }
+        Slot &slot{m_layout->slots[UNITS]};
+        slot.senderStamp.store(senderStamp, std::memory_order_relaxed);
+        m_layout->numberOfUnits.store(UNITS + 1, std::memory_order_release);
+        return &slot;
+    }
+
+   private:
+    bool m_writer{false};
+    std::unique_ptr<cluon::SharedMemory> m_sharedMemory{};
+    Layout *m_layout{nullptr};
+    std::vector<std::pair<uint32_t, uint32_t>> m_slots{};
+};
+
+#endif
@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SPLIT
+#define SPLIT
+
+#include <string>
+#include <vector>
+
+/**
+ * Split a string at each delimiter. Unlike stringtoolbox::split, a string
+ * without delimiter is kept as a single field, and empty fields are kept.
+ *
+ * @param str String to split.
+ * @param delimiter Character separating the fields.
+ * @return Fields in the order of the string.
+ */
+inline std::vector<std::string> split(const std::string &str, char delimiter) {
+    std::vector<std::string> retVal;
+    std::string::size_type prev{0};
+    for (std::string::size_type i{str.find(delimiter)}; i != std::string::npos; prev = i + 1, i = str.find(delimiter, prev)) {
+        retVal.emplace_back(str.substr(prev, i - prev));
+    }
+    retVal.emplace_back(str.substr(prev));
+    return retVal;
+}
+
+#endif
@@ -0,0 +1,317 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SPSC_RING
+#define SPSC_RING
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Policy to apply when the producer finds the ring full. KEEP_LATEST drops
+ * all entries not yet taken on every push so that the consumer only ever
+ * sees the most recent entry. BLOCK lets the producer wait for free space
+ * and hence never drops.
+ */
+enum class OverflowPolicy : uint8_t {
+    DROP_OLDEST,
+    DROP_NEWEST,
+    KEEP_LATEST,
+    BLOCK,
+};
+
+/**
+ * Bounded single-producer/single-consumer ring. Unless the policy is BLOCK,
+ * the producer never waits: push() completes in a bounded number of steps
+ * regardless of the consumer.
+ * The consumer spins adaptively and then sleeps on a futex; the producer
+ * only issues the wake-up syscall when the consumer is actually sleeping.
+ * The consumer claims an entry before copying it, and twice as many slots
+ * as entries are allocated, so that the producer never overwrites the slot
+ * the consumer is copying from, even when dropping entries it has not
+ * taken yet.
+ */
+template <typename T>
+class SPSCRing {
+    static_assert(std::is_trivially_copyable<T>::value, "SPSCRing requires trivially copyable entries.");
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "Futex word must be 32 bits.");
+
+   private:
+    SPSCRing(const SPSCRing &) = delete;
+    SPSCRing(SPSCRing &&)      = delete;
+    SPSCRing &operator=(const SPSCRing &) = delete;
+    SPSCRing &operator=(SPSCRing &&) = delete;
+
+   public:
+    /**
+     * Constructor.
+     *
+     * @param capacity Number of entries; rounded up to the next power of two.
+     * @param policy What to drop when the ring is full.
+     */
+    SPSCRing(uint32_t capacity, OverflowPolicy policy) noexcept
+        : m_policy{policy} {
+        uint32_t c{1};
+        while (c < capacity) {
+            c <<= 1;
+        }
+        m_capacity = c;
+        m_mask = 2 * c - 1;
+        m_slots.resize(2 * c);
+    }
+    ~SPSCRing() = default;
+
+   public:
+    /**
+     * Producer side: Add an entry; only blocks with OverflowPolicy::BLOCK.
+     *
+     * @param entry Entry to add.
+     * @return true if the entry was stored, false if it was dropped (DROP_NEWEST).
+     */
+    bool push(const T &entry) noexcept {
+        const uint64_t TAIL{m_tail.load(std::memory_order_relaxed)};
+        uint64_t head{m_head.load(std::memory_order_acquire)};
+        if (OverflowPolicy::KEEP_LATEST == m_policy) {
+            // Claim all entries not yet taken; a failed exchange means the
+            // consumer took some of them meanwhile.
+            while ( (head != TAIL) && !m_head.compare_exchange_weak(head, TAIL, std::memory_order_acq_rel, std::memory_order_acquire) ) {}
+            if (head != TAIL) {
+                m_dropped.fetch_add(TAIL - head, std::memory_order_relaxed);
+            }
+            head = TAIL;
+        }
+        if ( (OverflowPolicy::BLOCK == m_policy) && (TAIL - head >= m_capacity) ) {
+            m_blocked.fetch_add(1, std::memory_order_relaxed);
+            while (TAIL - head >= m_capacity) {
+                const uint32_t FREED{m_freed.load(std::memory_order_seq_cst)};
+                m_producerSleeping.store(true, std::memory_order_seq_cst);
+                if (TAIL - m_head.load(std::memory_order_seq_cst) >= m_capacity) {
+                    futex(m_freed, FUTEX_WAIT_PRIVATE, FREED, nullptr);
+                }
+                m_producerSleeping.store(false, std::memory_order_relaxed);
+                head = m_head.load(std::memory_order_acquire);
+            }
+        }
+        while (TAIL - head >= m_capacity) {
+            if (OverflowPolicy::DROP_NEWEST == m_policy) {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            // Claim the oldest slot from the consumer. This can only fail if
+            // the consumer took that entry meanwhile, which frees a slot.
+            if (m_head.compare_exchange_weak(head, head + 1, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                head++;
+                break;
+            }
+        }
+        // Entries claimed by the consumer recently are at most capacity
+        // entries older; only a consumer stalled while copying for as many
+        // pushes can still be reading the slot, and this entry is dropped.
+        const uint64_t READING{m_reading.load(std::memory_order_seq_cst)};
+        if ( (NOT_READING != READING) && ((READING & m_mask) == (TAIL & m_mask)) ) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        m_slots[TAIL & m_mask] = entry;
+        m_tail.store(TAIL + 1, std::memory_order_release);
+        if (TAIL + 1 - head > m_highWaterMark.load(std::memory_order_relaxed)) {
+            m_highWaterMark.store(static_cast<uint32_t>(TAIL + 1 - head), std::memory_order_relaxed);
+        }
+
+        m_sequence.fetch_add(1, std::memory_order_seq_cst);
+        if (m_consumerSleeping.load(std::memory_order_seq_cst)) {
+            futex(m_sequence, FUTEX_WAKE_PRIVATE, 1, nullptr);
+        }
+        return true;
+    }
+
+    /**
+     * Consumer side: Take the oldest entry if available; never blocks.
+     *
+     * @param entry Entry to fill.
+     * @return true if an entry was taken.
+     */
+    bool pop(T &entry) noexcept {
+        uint64_t head{m_head.load(std::memory_order_acquire)};
+        while (head != m_tail.load(std::memory_order_acquire)) {
+            // Announce the slot before claiming the entry so that the
+            // producer does not reuse it while it is copied; claiming fails
+            // if the producer dropped the entry meanwhile.
+            m_reading.store(head, std::memory_order_seq_cst);
+            if (m_head.compare_exchange_weak(head, head + 1, std::memory_order_seq_cst, std::memory_order_acquire)) {
+                entry = m_slots[head & m_mask];
+                m_reading.store(NOT_READING, std::memory_order_release);
+                if (OverflowPolicy::BLOCK == m_policy) {
+                    m_freed.fetch_add(1, std::memory_order_seq_cst);
+                    if (m_producerSleeping.load(std::memory_order_seq_cst)) {
+                        futex(m_freed, FUTEX_WAKE_PRIVATE, 1, nullptr);
+                    }
+                }
+                return true;
+            }
+        }
+        m_reading.store(NOT_READING, std::memory_order_release);
+        return false;
+    }
+
+    /**
+     * Consumer side: Take the oldest entry, waiting up to timeout for one.
+     *
+     * @param entry Entry to fill.
+     * @param timeout Maximum time to wait.
+     * @return true if an entry was taken.
+     */
+    bool waitAndPop(T &entry, std::chrono::microseconds timeout) noexcept {
+        if (pop(entry)) {
+            return true;
+        }
+
+        // Adaptive spinning: Grow the spin budget when spinning paid off and
+        // shrink it whenever we had to go to sleep anyway.
+        const uint32_t SPIN_LIMIT{m_spinLimit};
+        for (uint32_t i{0}; i < SPIN_LIMIT; i++) {
+            relax();
+            if (pop(entry)) {
+                m_spinLimit = (SPIN_LIMIT < MAX_SPINS) ? SPIN_LIMIT * 2 : MAX_SPINS;
+                return true;
+            }
+        }
+        m_spinLimit = (SPIN_LIMIT > MIN_SPINS) ? SPIN_LIMIT / 2 : MIN_SPINS;
+
+        const uint32_t SEQUENCE{m_sequence.load(std::memory_order_seq_cst)};
+        m_consumerSleeping.store(true, std::memory_order_seq_cst);
+        if (empty() && !m_wakeUpRequested.exchange(false)) {
+            struct timespec ts{};
+            ts.tv_sec  = static_cast<time_t>(timeout.count() / 1000000);
+            ts.tv_nsec = static_cast<long>((timeout.count() % 1000000) * 1000);
+            futex(m_sequence, FUTEX_WAIT_PRIVATE, SEQUENCE, &ts);
+        }
+        m_consumerSleeping.store(false, std::memory_order_relaxed);
+        return pop(entry);
+    }
+
+    /**
+     * Wake a waiting consumer without adding an entry (e.g., for shutdown).
+     */
+    void wakeUp() noexcept {
+        m_wakeUpRequested.store(true);
+        m_sequence.fetch_add(1, std::memory_order_seq_cst);
+        futex(m_sequence, FUTEX_WAKE_PRIVATE, 1, nullptr);
+    }
+
+    bool empty() const noexcept {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+    uint32_t size() const noexcept {
+        const uint64_t TAIL{m_tail.load(std::memory_order_acquire)};
+        const uint64_t HEAD{m_head.load(std::memory_order_acquire)};
+        return static_cast<uint32_t>((TAIL > HEAD) ? TAIL - HEAD : 0);
+    }
+
+    uint32_t capacity() const noexcept {
+        return m_capacity;
+    }
+
+    /**
+     * @return Number of entries dropped due to overflow so far.
+     */
+    uint64_t dropped() const noexcept {
+        return m_dropped.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @return Number of pushes that had to wait for free space (BLOCK).
+     */
+    uint64_t blocked() const noexcept {
+        return m_blocked.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @return Maximum number of entries held at once so far.
+     */
+    uint32_t highWaterMark() const noexcept {
+        return m_highWaterMark.load(std::memory_order_relaxed);
+    }
+
+   private:
+    static void relax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+        __asm__ __volatile__("yield");
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    static void futex(std::atomic<uint32_t> &word, int op, uint32_t value, const struct timespec *timeout) noexcept {
+        ::syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), op, value, timeout, nullptr, 0);
+    }
+
+   private:
+    static constexpr std::size_t CACHE_LINE{64};
+    static constexpr uint32_t MIN_SPINS{16};
+    static constexpr uint32_t MAX_SPINS{4096};
+    static constexpr uint64_t NOT_READING{~static_cast<uint64_t>(0)};
+
+    const OverflowPolicy m_policy;
+    uint32_t m_capacity{0};
+    uint32_t m_mask{0};
+    std::vector<T> m_slots{};
+
+    // Keep consumer and producer indices on separate cache lines. Padding is
+    // used instead of alignas() as C++14 has no over-aligned operator new.
+    char m_padding0[CACHE_LINE]{};
+    std::atomic<uint64_t> m_head{0};
+    std::atomic<uint64_t> m_reading{NOT_READING};
+    uint32_t m_spinLimit{MIN_SPINS};
+    char m_padding1[CACHE_LINE]{};
+    std::atomic<uint64_t> m_tail{0};
+    char m_padding2[CACHE_LINE]{};
+    std::atomic<uint32_t> m_sequence{0};
+    std::atomic<bool> m_consumerSleeping{false};
+    std::atomic<bool> m_wakeUpRequested{false};
+    std::atomic<uint64_t> m_dropped{0};
+    std::atomic<uint32_t> m_highWaterMark{0};
+    // Only used with OverflowPolicy::BLOCK.
+    std::atomic<uint32_t> m_freed{0};
+    std::atomic<bool> m_producerSleeping{false};
+    std::atomic<uint64_t> m_blocked{0};
+};
+
+template <typename T>
+constexpr std::size_t SPSCRing<T>::CACHE_LINE;
+template <typename T>
+constexpr uint32_t SPSCRing<T>::MIN_SPINS;
+template <typename T>
+constexpr uint32_t SPSCRing<T>::MAX_SPINS;
+template <typename T>
+constexpr uint64_t SPSCRing<T>::NOT_READING;
+
+#endif
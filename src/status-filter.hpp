@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STATUS_FILTER
+#define STATUS_FILTER
+
+#include "cluon-complete.hpp"
+#include "opendlv-device-gps-ncom-message-set.hpp"
+#include "split.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+
+/**
+ * Decides whether a Status is to be published: Whenever a mode or counter
+ * changes, an accuracy changes by more than its deadband since the last
+ * published Status, or the heartbeat interval has passed. The comparison
+ * only reads the message's members and does not allocate.
+ */
+class StatusFilter {
+   public:
+    /**
+     * Deadbands for the accuracies.
+     */
+    class Deadbands {
+       public:
+        // In m.
+        float position{0.01f};
+        // In m/s.
+        float velocity{0.01f};
+        // In rad.
+        float orientation{0.001f};
+    };
+
+   public:
+    StatusFilter() = default;
+
+    /**
+     * Constructor.
+     *
+     * @param deadbands Changes of accuracies to ignore.
+     * @param heartbeat Interval in microseconds to publish unchanged status.
+     */
+    StatusFilter(const Deadbands &deadbands, int64_t heartbeat) noexcept
+        : m_deadbands(deadbands)
+        , m_heartbeat(heartbeat) {}
+
+    /**
+     * @param status Current status.
+     * @param time Current (sample) time in microseconds.
+     * @return true if status is to be published; it is then remembered.
+     */
+    bool pass(const opendlv::device::gps::ncom::Status &status, int64_t time) noexcept {
+        const bool RETVAL{m_first
+            || (time - m_lastTime >= m_heartbeat) || (time < m_lastTime)
+            || (status.navigationStatus() != m_last.navigationStatus())
+            || (status.satellites() != m_last.satellites())
+            || (status.positionMode() != m_last.positionMode())
+            || (status.velocityMode() != m_last.velocityMode())
+            || (status.orientationMode() != m_last.orientationMode())
+            || exceeds(status.northAccuracy(), m_last.northAccuracy(), m_deadbands.position)
+            || exceeds(status.eastAccuracy(), m_last.eastAccuracy(), m_deadbands.position)
+            || exceeds(status.downAccuracy(), m_last.downAccuracy(), m_deadbands.position)
+            || exceeds(status.velocityNorthAccuracy(), m_last.velocityNorthAccuracy(), m_deadbands.velocity)
+            || exceeds(status.velocityEastAccuracy(), m_last.velocityEastAccuracy(), m_deadbands.velocity)
+            || exceeds(status.velocityDownAccuracy(), m_last.velocityDownAccuracy(), m_deadbands.velocity)
+            || exceeds(status.headingAccuracy(), m_last.headingAccuracy(), m_deadbands.orientation)
+            || exceeds(status.pitchAccuracy(), m_last.pitchAccuracy(), m_deadbands.orientation)
+            || exceeds(status.rollAccuracy(), m_last.rollAccuracy(), m_deadbands.orientation)};
+        if (RETVAL) {
+            m_first = false;
+            m_last = status;
+            m_lastTime = time;
+        }
+        return RETVAL;
+    }
+
+    /**
+     * Parse deadbands given as position:m,velocity:m/s,orientation:rad; any
+     * of the entries may be omitted, but none may be empty.
+     *
+     * @param deadbands List of deadbands.
+     * @param retVal Deadbands to update.
+     * @return true if all entries could be parsed.
+     */
+    static bool parseDeadbands(const std::string &deadbands, Deadbands &retVal) noexcept {
+        if (deadbands.empty()) {
+            return true;
+        }
+        try {
+            for (auto entry : split(deadbands, ',')) {
+                entry = stringtoolbox::trim(entry);
+                const std::string::size_type COLON{entry.find(':')};
+                const std::string NAME{entry.substr(0, COLON)};
+                if (std::string::npos == COLON) {
+                    return false;
+                }
+                const float VALUE{std::stof(entry.substr(COLON + 1))};
+                if ("position" == NAME) {
+                    retVal.position = VALUE;
+                } else if ("velocity" == NAME) {
+                    retVal.velocity = VALUE;
+                } else if ("orientation" == NAME) {
+                    retVal.orientation = VALUE;
+                } else {
+                    return false;
+                }
+            }
+        } catch (...) {
+            return false;
+        }
+        return true;
+    }
+
+   private:
+    static bool exceeds(float value, float last, float deadband) noexcept {
+        return std::fabs(value - last) > deadband;
+    }
+
+   private:
+    Deadbands m_deadbands{};
+    int64_t m_heartbeat{1000000};
+    bool m_first{true};
+    int64_t m_lastTime{0};
+    opendlv::device::gps::ncom::Status m_last{};
+};
+
+#endif
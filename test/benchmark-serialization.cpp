@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cluon-complete.hpp"
+#include "opendlv-standard-message-set.hpp"
+
+#include "envelope-template.hpp"
+#include "nav-state.hpp"
+#include "ncom-decoder.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <utility>
+
+namespace {
+// Serialization as done by cluon::OD4Session::send().
+template <typename T>
+std::size_t generic(T &message, const cluon::data::TimeStamp &sent, const cluon::data::TimeStamp &sampleTime, uint32_t senderStamp) {
+    cluon::ToProtoVisitor protoEncoder;
+    cluon::data::Envelope envelope;
+    envelope.dataType(static_cast<int32_t>(message.ID()));
+    message.accept(protoEncoder);
+    envelope.serializedData(protoEncoder.encodedData());
+    envelope.sent(sent);
+    envelope.sampleTimeStamp(sampleTime);
+    envelope.senderStamp(senderStamp);
+    return cluon::serializeEnvelope(std::move(envelope)).size();
+}
+
+template <typename T>
+std::size_t patched(EnvelopeTemplate &envelope, const T &message, const EnvelopeTemplate::MetaData &metaData) {
+    envelope.update(message, metaData);
+    return envelope.size();
+}
+}
+
+/**
+ * Measures the serialization of all messages of one NCOM packet through
+ * cluon's generic ToProtoVisitor and through EnvelopeTemplate.
+ */
+int32_t main(int32_t argc, char **argv) {
+    const int32_t ITERATIONS{(1 < argc) ? std::atoi(argv[1]) : 100000};
+
+    NavState state;
+    state.sampleTime.seconds(1500000000).microseconds(123456);
+    state.senderStamp = 1;
+    NCOMDecoder::NCOMMessages &m{state.messages};
+    m.acceleration.accelerationX(0.21f).accelerationY(0.37f).accelerationZ(-9.80f);
+    m.angularVelocity.angularVelocityX(0.001f).angularVelocityY(-0.002f).angularVelocityZ(0.003f);
+    m.position.latitude(57.71).longitude(11.94);
+    m.heading.northHeading(1.2f);
+    m.speed.groundSpeed(13.4f);
+    m.altitude.altitude(42.0f);
+    m.geolocation.latitude(57.71).longitude(11.94).altitude(42.0f).heading(1.2f);
+    m.equilibrioception.vx(13.0f).vy(0.1f).vz(0.0f).rollRate(0.001f).pitchRate(-0.002f).yawRate(0.003f);
+    m.status.navigationStatus(4).satellites(12);
+    opendlv::device::gps::ncom::NavState compound{state.compound()};
+    opendlv::device::gps::ncom::Attitude attitude{state.attitude()};
+
+    EnvelopeTemplate acceleration{opendlv::proxy::AccelerationReading()};
+    EnvelopeTemplate angularVelocity{opendlv::proxy::AngularVelocityReading()};
+    EnvelopeTemplate position{opendlv::proxy::GeodeticWgs84Reading()};
+    EnvelopeTemplate heading{opendlv::proxy::GeodeticHeadingReading()};
+    EnvelopeTemplate speed{opendlv::proxy::GroundSpeedReading()};
+    EnvelopeTemplate altitude{opendlv::proxy::AltitudeReading()};
+    EnvelopeTemplate geolocation{opendlv::logic::sensation::Geolocation()};
+    EnvelopeTemplate navState{opendlv::device::gps::ncom::NavState()};
+    EnvelopeTemplate equilibrioception{opendlv::logic::sensation::Equilibrioception()};
+    EnvelopeTemplate attitudeMessage{opendlv::device::gps::ncom::Attitude()};
+    EnvelopeTemplate status{opendlv::device::gps::ncom::Status()};
+
+    // Sum of the sizes keeps the compiler from dropping the work.
+    std::size_t genericBytes{0};
+    std::size_t patchedBytes{0};
+    cluon::data::TimeStamp sent{cluon::time::now()};
+
+    const auto GENERIC_START{std::chrono::steady_clock::now()};
+    for (int32_t i{0}; i < ITERATIONS; i++) {
+        sent.microseconds(i % 1000000);
+        genericBytes += generic(m.acceleration, sent, state.sampleTime, state.senderStamp);
+        genericBytes += generic(m.angularVelocity, sent, state.sampleTime, state.senderStamp);
+        genericBytes += generic(m.position, sent, state.sampleTime, state.senderStamp);
+        genericBytes += generic(m.heading, sent, state.sampleTime, state.senderStamp);
+        genericBytes += generic(m.speed, sent, state.sampleTime, state.senderStamp);
+        genericBytes += generic(m.altitude, sent, state.sampleTime, state.senderStamp);
+        genericBytes += generic(m.geolocation, sent, state.sampleTime, state.senderStamp);
+        genericBytes += generic(compound, sent, state.sampleTime, state.senderStamp);
+        genericBytes += generic(m.equilibrioception, sent, state.sampleTime, state.senderStamp);
+        genericBytes += generic(attitude, sent, state.sampleTime, state.senderStamp);
+        genericBytes += generic(m.status, sent, state.sampleTime, state.senderStamp);
+    }
+    const auto GENERIC_END{std::chrono::steady_clock::now()};
+
+    const auto PATCHED_START{std::chrono::steady_clock::now()};
+    for (int32_t i{0}; i < ITERATIONS; i++) {
+        sent.microseconds(i % 1000000);
+        // As in NavStatePublisher::publish(), meta data is encoded once per packet.
+        const EnvelopeTemplate::MetaData META{sent, state.sampleTime, state.senderStamp};
+        patchedBytes += patched(acceleration, m.acceleration, META);
+        patchedBytes += patched(angularVelocity, m.angularVelocity, META);
+        patchedBytes += patched(position, m.position, META);
+        patchedBytes += patched(heading, m.heading, META);
+        patchedBytes += patched(speed, m.speed, META);
+        patchedBytes += patched(altitude, m.altitude, META);
+        patchedBytes += patched(geolocation, m.geolocation, META);
+        patchedBytes += patched(navState, compound, META);
+        patchedBytes += patched(equilibrioception, m.equilibrioception, META);
+        patchedBytes += patched(attitudeMessage, attitude, META);
+        patchedBytes += patched(status, m.status, META);
+    }
+    const auto PATCHED_END{std::chrono::steady_clock::now()};
+
+    const double GENERIC_NS{std::chrono::duration<double, std::nano>(GENERIC_END - GENERIC_START).count() / ITERATIONS};
+    const double PATCHED_NS{std::chrono::duration<double, std::nano>(PATCHED_END - PATCHED_START).count() / ITERATIONS};
+    std::cout << "Messages of one NCOM packet (11 envelopes), " << ITERATIONS << " iterations:" << std::endl
+              << "  cluon::ToProtoVisitor: " << GENERIC_NS << " ns/packet (" << genericBytes / static_cast<std::size_t>(ITERATIONS) << " bytes)" << std::endl
+              << "  EnvelopeTemplate:      " << PATCHED_NS << " ns/packet (" << patchedBytes / static_cast<std::size_t>(ITERATIONS) << " bytes)" << std::endl
+              << "  Speed-up:              " << GENERIC_NS / PATCHED_NS << "x" << std::endl;
+    return 0;
+}
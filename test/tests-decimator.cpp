@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+
+#include "decimator.hpp"
+
+#include <cstdint>
+
+TEST_CASE("Test default Decimator passes every sample.") {
+    Decimator d;
+    uint32_t passed{0};
+    for (int64_t t{0}; t < 100; t++) {
+        passed += (d.pass(t * 10000) ? 1 : 0);
+    }
+    REQUIRE(100 == passed);
+}
+
+TEST_CASE("Test Decimator on packet count.") {
+    Decimator d{20.0f, Decimator::Mode::PACKET_COUNT, 250.0f};
+    uint32_t passed{0};
+    for (int64_t t{0}; t < 250; t++) {
+        // Sample time is ignored.
+        passed += (d.pass(0) ? 1 : 0);
+    }
+    // Every 13th packet (250/20 = 12.5 rounded).
+    REQUIRE(20 == passed);
+
+    Decimator all{500.0f, Decimator::Mode::PACKET_COUNT, 250.0f};
+    REQUIRE(all.pass(0));
+    REQUIRE(all.pass(0));
+
+    Decimator none{0.0f, Decimator::Mode::PACKET_COUNT, 250.0f};
+    REQUIRE(!none.pass(0));
+}
+
+TEST_CASE("Test Decimator on sample time.") {
+    Decimator d{20.0f, Decimator::Mode::SAMPLE_TIME, 0.0f};
+    uint32_t passed{0};
+    const int64_t START{1538000000LL * 1000000LL + 1234};
+    // 250 Hz for two seconds.
+    for (int64_t i{0}; i < 500; i++) {
+        passed += (d.pass(START + i * 4000) ? 1 : 0);
+    }
+    REQUIRE(40 == passed);
+
+    // Lost packets do not shift the output.
+    Decimator e{10.0f, Decimator::Mode::SAMPLE_TIME, 0.0f};
+    REQUIRE(e.pass(START));
+    REQUIRE(!e.pass(START + 50000));
+    REQUIRE(e.pass(START + 250000));
+    REQUIRE(!e.pass(START + 290000));
+    REQUIRE(e.pass(START + 300000));
+}
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+
+#include "cluon-complete.hpp"
+#include "opendlv-standard-message-set.hpp"
+#include "opendlv-device-gps-ncom-message-set.hpp"
+
+#include "envelope-template.hpp"
+
+#include <sstream>
+#include <string>
+#include <utility>
+
+namespace {
+cluon::data::Envelope unpack(const EnvelopeTemplate &t) {
+    std::stringstream sstr(std::string(t.data(), t.size()));
+    auto retVal = cluon::extractEnvelope(sstr);
+    REQUIRE(retVal.first);
+    return retVal.second;
+}
+}
+
+TEST_CASE("Test EnvelopeTemplate produces envelopes decodable by cluon.") {
+    EnvelopeTemplate t{opendlv::logic::sensation::Geolocation()};
+    REQUIRE(t.isValid());
+    const std::size_t SIZE{t.size()};
+
+    for (int32_t seconds : {0, 1, 1538000000, -5}) {
+        opendlv::logic::sensation::Geolocation msg;
+        msg.latitude(57.71).longitude(-11.94).altitude(-42.5f).heading(3.1f);
+        cluon::data::TimeStamp sent;
+        sent.seconds(seconds + 1).microseconds(999999);
+        cluon::data::TimeStamp sample;
+        sample.seconds(seconds).microseconds(123);
+        t.update(msg, sent, sample, 0xFFFFFFFF);
+        REQUIRE(SIZE == t.size());
+
+        cluon::data::Envelope env{unpack(t)};
+        REQUIRE(opendlv::logic::sensation::Geolocation::ID() == env.dataType());
+        REQUIRE(seconds + 1 == env.sent().seconds());
+        REQUIRE(999999 == env.sent().microseconds());
+        REQUIRE(seconds == env.sampleTimeStamp().seconds());
+        REQUIRE(123 == env.sampleTimeStamp().microseconds());
+        REQUIRE(0 == env.received().seconds());
+        REQUIRE(0xFFFFFFFF == env.senderStamp());
+
+        auto decoded = cluon::extractMessage<opendlv::logic::sensation::Geolocation>(std::move(env));
+        REQUIRE(57.71 == Approx(decoded.latitude()));
+        REQUIRE(-11.94 == Approx(decoded.longitude()));
+        REQUIRE(-42.5f == Approx(decoded.altitude()));
+        REQUIRE(3.1f == Approx(decoded.heading()));
+    }
+}
+
+TEST_CASE("Test EnvelopeTemplate handles integer fields and missing sample time.") {
+    EnvelopeTemplate s{opendlv::proxy::SwitchStateReading()};
+    REQUIRE(s.isValid());
+    opendlv::proxy::SwitchStateReading state;
+    state.state(-300);
+    cluon::data::TimeStamp sent;
+    sent.seconds(10).microseconds(20);
+    s.update(state, sent, cluon::data::TimeStamp(), 7);
+    cluon::data::Envelope env{unpack(s)};
+    REQUIRE(10 == env.sampleTimeStamp().seconds());
+    REQUIRE(20 == env.sampleTimeStamp().microseconds());
+    REQUIRE(-300 == cluon::extractMessage<opendlv::proxy::SwitchStateReading>(std::move(env)).state());
+
+    EnvelopeTemplate p{opendlv::proxy::PulseWidthModulationRequest()};
+    opendlv::proxy::PulseWidthModulationRequest pwm;
+    pwm.dutyCycleNs(0xFFFFFFFF);
+    p.update(pwm, sent, sent, 0);
+    REQUIRE(0xFFFFFFFF == cluon::extractMessage<opendlv::proxy::PulseWidthModulationRequest>(unpack(p)).dutyCycleNs());
+
+    // Strings have no fixed layout.
+    EnvelopeTemplate invalid{opendlv::system::SignalStatusMessage()};
+    REQUIRE(!invalid.isValid());
+}
+
+TEST_CASE("Test EnvelopeTemplate with meta data shared by several messages.") {
+    cluon::data::TimeStamp sent;
+    sent.seconds(1000).microseconds(5);
+    cluon::data::TimeStamp sampleTime;
+    sampleTime.seconds(999).microseconds(123456);
+    const EnvelopeTemplate::MetaData META{sent, sampleTime, 3};
+
+    opendlv::proxy::GroundSpeedReading speed;
+    speed.groundSpeed(12.5f);
+    EnvelopeTemplate a{opendlv::proxy::GroundSpeedReading()};
+    EnvelopeTemplate b{opendlv::proxy::GroundSpeedReading()};
+    a.update(speed, sent, sampleTime, 3);
+    b.update(speed, META);
+    REQUIRE(std::string(a.data(), a.size()) == std::string(b.data(), b.size()));
+
+    opendlv::proxy::AltitudeReading altitude;
+    altitude.altitude(42.0f);
+    EnvelopeTemplate c{opendlv::proxy::AltitudeReading()};
+    c.update(altitude, META);
+    cluon::data::Envelope env{unpack(c)};
+    REQUIRE(1000 == env.sent().seconds());
+    REQUIRE(999 == env.sampleTimeStamp().seconds());
+    REQUIRE(123456 == env.sampleTimeStamp().microseconds());
+    REQUIRE(3 == env.senderStamp());
+    REQUIRE(42.0f == Approx(cluon::extractMessage<opendlv::proxy::AltitudeReading>(std::move(env)).altitude()));
+}
+
+TEST_CASE("Test EnvelopeTemplate for a fixed-length bytes field.") {
+    EnvelopeTemplate t{opendlv::device::gps::ncom::RawPacket::ID(), 1, 72};
+    REQUIRE(t.isValid());
+
+    std::string packet(72, '\0');
+    for (std::size_t i{0}; i < packet.size(); i++) {
+        packet[i] = static_cast<char>(0xE7 + i);
+    }
+    cluon::data::TimeStamp sent;
+    sent.seconds(20).microseconds(1);
+    cluon::data::TimeStamp received;
+    received.seconds(19).microseconds(999999);
+    t.update(packet.data(), sent, received, received, 5);
+
+    cluon::data::Envelope env{unpack(t)};
+    REQUIRE(opendlv::device::gps::ncom::RawPacket::ID() == env.dataType());
+    REQUIRE(20 == env.sent().seconds());
+    REQUIRE(19 == env.received().seconds());
+    REQUIRE(999999 == env.received().microseconds());
+    REQUIRE(19 == env.sampleTimeStamp().seconds());
+    REQUIRE(5 == env.senderStamp());
+    REQUIRE(packet == cluon::extractMessage<opendlv::device::gps::ncom::RawPacket>(std::move(env)).data());
+}
+
@@ -0,0 +1,397 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+
+#include "cluon-complete.hpp"
+#include "opendlv-standard-message-set.hpp"
+
+#include "nav-state-publisher.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+/**
+ * Collects the envelopes sent to an OD4 session.
+ */
+class Collector {
+   private:
+    Collector(const Collector &) = delete;
+    Collector(Collector &&)      = delete;
+    Collector &operator=(const Collector &) = delete;
+    Collector &operator=(Collector &&) = delete;
+
+   public:
+    /**
+     * Constructor.
+     *
+     * @param cid OD4 session to listen to.
+     * @param filter Functional returning false for envelopes not to collect.
+     */
+    explicit Collector(uint16_t cid, std::function<bool(cluon::data::Envelope &)> filter = nullptr)
+        : m_filter(std::move(filter))
+        , m_od4(cid, [this](cluon::data::Envelope &&envelope) {
+            if ( (nullptr == m_filter) || m_filter(envelope) ) {
+                std::lock_guard<std::mutex> lck(m_mutex);
+                m_envelopes.push_back(envelope);
+            }
+        }) {}
+
+    /**
+     * Wait until the expected number of envelopes arrived or 5s passed, and a
+     * bit longer to also catch unexpected ones.
+     *
+     * @param expected Number of envelopes to wait for.
+     * @return Envelopes collected since the last call.
+     */
+    std::vector<cluon::data::Envelope> collect(std::size_t expected) {
+        using namespace std::literals::chrono_literals;
+        const auto DEADLINE{std::chrono::steady_clock::now() + 5s};
+        while (std::chrono::steady_clock::now() < DEADLINE) {
+            {
+                std::lock_guard<std::mutex> lck(m_mutex);
+                if (expected <= m_envelopes.size()) {
+                    break;
+                }
+            }
+            std::this_thread::sleep_for(10ms);
+        }
+        std::this_thread::sleep_for(50ms);
+
+        std::lock_guard<std::mutex> lck(m_mutex);
+        std::vector<cluon::data::Envelope> retVal;
+        retVal.swap(m_envelopes);
+        return retVal;
+    }
+
+   private:
+    std::function<bool(cluon::data::Envelope &)> m_filter;
+    std::mutex m_mutex{};
+    std::vector<cluon::data::Envelope> m_envelopes{};
+    cluon::OD4Session m_od4;
+};
+
+uint32_t count(const std::vector<cluon::data::Envelope> &envelopes, int32_t dataType) {
+    uint32_t retVal{0};
+    for (auto &env : envelopes) {
+        retVal += (dataType == env.dataType()) ? 1 : 0;
+    }
+    return retVal;
+}
+}
+
+TEST_CASE("Test NavStatePublisher sends all messages to an OD4 session.") {
+    Collector collector{198};
+
+    NavStatePublisher publisher{198};
+    REQUIRE(publisher.isValid());
+    NavState state;
+    state.sampleTime.seconds(1000).microseconds(2000);
+    state.senderStamp = 3;
+    state.messages.position.latitude(57.5).longitude(12.25);
+    state.messages.speed.groundSpeed(13.5f);
+    publisher.publish(state);
+
+    auto received = collector.collect(7);
+    REQUIRE(7 == received.size());
+    bool foundPosition{false};
+    bool foundSpeed{false};
+    for (auto &env : received) {
+        REQUIRE(3 == env.senderStamp());
+        REQUIRE(1000 == env.sampleTimeStamp().seconds());
+        REQUIRE(2000 == env.sampleTimeStamp().microseconds());
+        if (opendlv::proxy::GeodeticWgs84Reading::ID() == env.dataType()) {
+            auto msg = cluon::extractMessage<opendlv::proxy::GeodeticWgs84Reading>(std::move(env));
+            foundPosition = (57.5 == Approx(msg.latitude())) && (12.25 == Approx(msg.longitude()));
+        }
+        if (opendlv::proxy::GroundSpeedReading::ID() == env.dataType()) {
+            foundSpeed = (13.5f == Approx(cluon::extractMessage<opendlv::proxy::GroundSpeedReading>(std::move(env)).groundSpeed()));
+        }
+    }
+    REQUIRE(foundPosition);
+    REQUIRE(foundSpeed);
+}
+
+TEST_CASE("Test NavStatePublisher sends only the compound NavState message.") {
+    Collector collector{199};
+
+    NavStatePublisher publisher{199, NavStatePublisher::Messages::COMPOUND};
+    REQUIRE(publisher.isValid());
+    NavState state;
+    state.sampleTime.seconds(1000).microseconds(2000);
+    state.senderStamp = 4;
+    state.messages.position.latitude(57.5).longitude(12.25);
+    state.messages.pitch = -0.1f;
+    state.messages.roll = 0.2f;
+    state.messages.equilibrioception.vx(1.5f).vy(-2.5f).vz(0.25f);
+    state.messages.acceleration.accelerationZ(-9.81f);
+    publisher.publish(state);
+
+    auto received = collector.collect(1);
+    REQUIRE(1 == received.size());
+    REQUIRE(opendlv::device::gps::ncom::NavState::ID() == received[0].dataType());
+    REQUIRE(4 == received[0].senderStamp());
+    auto msg = cluon::extractMessage<opendlv::device::gps::ncom::NavState>(std::move(received[0]));
+    REQUIRE(57.5 == Approx(msg.latitude()));
+    REQUIRE(12.25 == Approx(msg.longitude()));
+    REQUIRE(-0.1f == Approx(msg.pitch()));
+    REQUIRE(0.2f == Approx(msg.roll()));
+    REQUIRE(1.5f == Approx(msg.velocityNorth()));
+    // Equilibrioception is north, west, up.
+    REQUIRE(2.5f == Approx(msg.velocityEast()));
+    REQUIRE(-0.25f == Approx(msg.velocityDown()));
+    REQUIRE(-9.81f == Approx(msg.accelerationZ()));
+}
+
+TEST_CASE("Test NavStatePublisher decimates messages per unit.") {
+    using namespace std::literals::chrono_literals;
+    Collector collector{200};
+
+    NavStatePublisher publisher{200};
+    REQUIRE(!publisher.setRates("Geolocation:20,Unknown:1", Decimator::Mode::SAMPLE_TIME, 100.0f));
+    REQUIRE(!publisher.setRates("Geolocation:20,,AltitudeReading", Decimator::Mode::SAMPLE_TIME, 100.0f));
+    // Rates that would silently turn a message type off or are not numbers.
+    for (auto rates : {"Geolocation:0", "Geolocation:-10", "Geolocation:10Hz", "Geolocation:nan", "Geolocation:inf", "Geolocation:"}) {
+        REQUIRE(!publisher.setRates(rates, Decimator::Mode::SAMPLE_TIME, 100.0f));
+    }
+    REQUIRE(publisher.setRates("Geolocation:20", Decimator::Mode::SAMPLE_TIME, 100.0f));
+
+    // 100 Hz for 0.5s from two units.
+    for (int32_t i{0}; i < 50; i++) {
+        for (uint32_t unit{0}; unit < 2; unit++) {
+            NavState state;
+            state.sampleTime.seconds(1000).microseconds(i * 10000);
+            state.senderStamp = unit;
+            publisher.publish(state);
+        }
+        std::this_thread::sleep_for(1ms);
+    }
+
+    // Six undecimated messages and Geolocation at 20 Hz for each unit.
+    auto received = collector.collect(2 * (6 * 50 + 10));
+    REQUIRE(2 * 10 == count(received, opendlv::logic::sensation::Geolocation::ID()));
+    REQUIRE(2 * 50 == count(received, opendlv::proxy::AltitudeReading::ID()));
+    REQUIRE(2 * 50 == count(received, opendlv::proxy::AccelerationReading::ID()));
+}
+
+TEST_CASE("Test NavStatePublisher publishes only the message types routed to its session.") {
+    using namespace std::literals::chrono_literals;
+    Collector collector{205};
+
+    NavStatePublisher publisher{205, NavStatePublisher::Messages::BOTH, true};
+    REQUIRE(!publisher.setRates("AccelerationReading,Unknown", Decimator::Mode::SAMPLE_TIME, 100.0f, true));
+    REQUIRE(publisher.setRates("AccelerationReading, Geolocation:20", Decimator::Mode::SAMPLE_TIME, 100.0f, true));
+
+    // 100 Hz for 0.5s.
+    for (int32_t i{0}; i < 50; i++) {
+        NavState state;
+        state.sampleTime.seconds(1000).microseconds(i * 10000);
+        publisher.publish(state);
+        std::this_thread::sleep_for(1ms);
+    }
+
+    auto received = collector.collect(60);
+    REQUIRE(10 == count(received, opendlv::logic::sensation::Geolocation::ID()));
+    REQUIRE(50 == count(received, opendlv::proxy::AccelerationReading::ID()));
+    REQUIRE(60 == received.size());
+}
+
+TEST_CASE("Test NavStatePublisher sends Equilibrioception and Attitude.") {
+    Collector collector{201};
+
+    NavStatePublisher publisher{201, NavStatePublisher::Messages::COMPOUND, true};
+    REQUIRE(publisher.isValid());
+    NavState state;
+    state.messages.equilibrioception.vx(1.0f).yawRate(0.5f);
+    state.messages.pitch = 0.25f;
+    publisher.publish(state);
+
+    auto received = collector.collect(3);
+    REQUIRE(3 == received.size());
+    bool foundEquilibrioception{false};
+    bool foundAttitude{false};
+    for (auto &env : received) {
+        if (opendlv::logic::sensation::Equilibrioception::ID() == env.dataType()) {
+            auto msg = cluon::extractMessage<opendlv::logic::sensation::Equilibrioception>(std::move(env));
+            foundEquilibrioception = (1.0f == Approx(msg.vx())) && (0.5f == Approx(msg.yawRate()));
+        }
+        if (opendlv::device::gps::ncom::Attitude::ID() == env.dataType()) {
+            auto msg = cluon::extractMessage<opendlv::device::gps::ncom::Attitude>(std::move(env));
+            foundAttitude = (0.25f == Approx(msg.pitch())) && (std::cos(0.25f) == Approx(msg.r33()));
+        }
+    }
+    REQUIRE(foundEquilibrioception);
+    REQUIRE(foundAttitude);
+}
+
+TEST_CASE("Test NavStatePublisher passes raw NCOM packets through.") {
+    Collector collector{202};
+
+    NavStatePublisher publisher{202};
+    const std::string PACKET(72, static_cast<char>(0xE7));
+    cluon::data::TimeStamp tp;
+    tp.seconds(1000);
+    publisher.publishRaw(PACKET.data(), PACKET.size(), tp, 6);
+    // Other lengths are ignored.
+    publisher.publishRaw(PACKET.data(), 71, tp, 6);
+
+    auto received = collector.collect(1);
+    REQUIRE(1 == received.size());
+    REQUIRE(6 == received[0].senderStamp());
+    // OD4Session overwrites the received time stamp; sample time carries it.
+    REQUIRE(1000 == received[0].sampleTimeStamp().seconds());
+    REQUIRE(PACKET == cluon::extractMessage<opendlv::device::gps::ncom::RawPacket>(std::move(received[0])).data());
+}
+
+TEST_CASE("Test NavStatePublisher publishes Status only on change.") {
+    using namespace std::literals::chrono_literals;
+    Collector collector{203, [](cluon::data::Envelope &envelope) {
+        return opendlv::device::gps::ncom::Status::ID() == envelope.dataType();
+    }};
+
+    NavStatePublisher publisher{203};
+    publisher.enableStatus(StatusFilter::Deadbands(), 10s);
+    // 100 Hz for one second with one change of satellites.
+    for (int32_t i{0}; i < 100; i++) {
+        NavState state;
+        state.sampleTime.seconds(1000 + i / 100).microseconds((i % 100) * 10000);
+        state.messages.status.navigationStatus(4).satellites((50 > i) ? 9 : 10);
+        publisher.publish(state);
+        std::this_thread::sleep_for(1ms);
+    }
+
+    auto received = collector.collect(2);
+    REQUIRE(2 == received.size());
+    REQUIRE(9 == cluon::extractMessage<opendlv::device::gps::ncom::Status>(std::move(received[0])).satellites());
+    REQUIRE(10 == cluon::extractMessage<opendlv::device::gps::ncom::Status>(std::move(received[1])).satellites());
+}
+
+TEST_CASE("Test NavStatePublisher publishes only subscribed messages.") {
+    using namespace std::literals::chrono_literals;
+    NavStatePublisher publisher{204};
+    publisher.enableSubscriptions(true, Decimator::Mode::SAMPLE_TIME, 100.0f);
+    REQUIRE(!publisher.subscribe(1, "Unknown", 1.0f));
+
+    Collector collector{204, [&publisher](cluon::data::Envelope &envelope) {
+        if (opendlv::device::gps::ncom::SubscriptionRequest::ID() == envelope.dataType()) {
+            const uint32_t REQUESTER{envelope.senderStamp()};
+            auto request = cluon::extractMessage<opendlv::device::gps::ncom::SubscriptionRequest>(std::move(envelope));
+            publisher.subscribe(REQUESTER, request.name(), request.rate());
+            return false;
+        }
+        return true;
+    }};
+
+    // 100 Hz for 0.5s; returns the number of Geolocations and of all messages.
+    auto run = [&collector, &publisher](std::size_t expected) {
+        for (int32_t i{0}; i < 50; i++) {
+            NavState state;
+            state.sampleTime.seconds(1000).microseconds(i * 10000);
+            publisher.publish(state);
+            std::this_thread::sleep_for(1ms);
+        }
+        auto received = collector.collect(expected);
+        return std::make_pair(count(received, opendlv::logic::sensation::Geolocation::ID()), static_cast<uint32_t>(received.size()));
+    };
+    // Sessions do not receive their own envelopes.
+    cluon::OD4Session consumer{204};
+    auto request = [&consumer](uint32_t requester, const std::string &name, float rate) {
+        opendlv::device::gps::ncom::SubscriptionRequest r;
+        r.name(name).rate(rate);
+        consumer.send(r, cluon::time::now(), requester);
+        std::this_thread::sleep_for(100ms);
+    };
+
+    // Nothing is published without subscribers.
+    REQUIRE(0 == run(0).second);
+
+    request(7, "Geolocation", -1.0f);
+    auto counts = run(50);
+    REQUIRE(50 == counts.first);
+    REQUIRE(50 == counts.second);
+
+    // The highest rate wins until its requester unsubscribes.
+    request(8, "Geolocation", 20.0f);
+    REQUIRE(50 == run(50).first);
+    request(7, "Geolocation", 0.0f);
+    REQUIRE(10 == run(10).first);
+
+    request(8, "Geolocation", 0.0f);
+    REQUIRE(0 == run(0).second);
+}
+
+TEST_CASE("Test NavStatePublisher ends subscriptions that were not renewed.") {
+    using namespace std::literals::chrono_literals;
+    Collector collector{206};
+    NavStatePublisher publisher{206};
+    publisher.enableSubscriptions(true, Decimator::Mode::SAMPLE_TIME, 100.0f, 300ms);
+
+    auto publish = [&publisher]() {
+        NavState state;
+        publisher.publish(state);
+    };
+
+    REQUIRE(publisher.subscribe(1, "Geolocation", -1.0f));
+    publish();
+    REQUIRE(1 == collector.collect(1).size());
+
+    // Renewed within the lease.
+    std::this_thread::sleep_for(200ms);
+    REQUIRE(publisher.subscribe(1, "Geolocation", -1.0f));
+    std::this_thread::sleep_for(200ms);
+    REQUIRE(0 == publisher.expireSubscriptions());
+    publish();
+    REQUIRE(1 == collector.collect(1).size());
+
+    std::this_thread::sleep_for(300ms);
+    REQUIRE(1 == publisher.expireSubscriptions());
+    publish();
+    REQUIRE(collector.collect(0).empty());
+}
+
+TEST_CASE("Test NavStatePublisher keeps subscriptions unchanged when a request cannot be queued.") {
+    Collector collector{207};
+    NavStatePublisher publisher{207};
+    publisher.enableSubscriptions(true, Decimator::Mode::SAMPLE_TIME, 100.0f);
+
+    // Fill the ring of requests as nothing is published meanwhile.
+    uint32_t requester{0};
+    while (publisher.subscribe(requester, "Geolocation", -1.0f)) {
+        requester++;
+    }
+    REQUIRE(0 < requester);
+
+    // Apply the queued requests, and end all accepted subscriptions.
+    NavState state;
+    publisher.publish(state);
+    REQUIRE(1 == collector.collect(1).size());
+    for (uint32_t i{0}; i < requester; i++) {
+        REQUIRE(publisher.subscribe(i, "Geolocation", 0.0f));
+    }
+
+    // The rejected requester did not remain subscribed.
+    publisher.publish(state);
+    REQUIRE(collector.collect(0).empty());
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+
+#include "nav-state-server.hpp"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <thread>
+
+namespace {
+int32_t subscribe(const std::string &path) {
+    struct sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size());
+    address.sun_path[0] = '\0';
+    const int32_t FD{::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0)};
+    if (0 != ::connect(FD, reinterpret_cast<struct sockaddr *>(&address), static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) + path.size()))) {
+        ::close(FD);
+        return -1;
+    }
+    return FD;
+}
+
+// Flush until the server has picked up the given number of subscribers.
+bool waitFor(NavStateServer &server, std::size_t subscribers) {
+    using namespace std::literals::chrono_literals;
+    for (uint32_t i{0}; (i < 100) && (subscribers != server.subscribers()); i++) {
+        std::this_thread::sleep_for(10ms);
+        server.flush();
+    }
+    return subscribers == server.subscribers();
+}
+}
+
+TEST_CASE("Test NavStateServer rejects invalid paths.") {
+    REQUIRE(!NavStateServer("").isValid());
+    REQUIRE(!NavStateServer(std::string(200, 'x')).isValid());
+    REQUIRE(!NavStateServer("/nonexisting/directory/socket").isValid());
+}
+
+TEST_CASE("Test NavStateServer sends each batch as one packet to every subscriber.") {
+    NavStateServer server{"@opendlv-device-gps-ncom-test-1"};
+    REQUIRE(server.isValid());
+    const int32_t FIRST{subscribe("@opendlv-device-gps-ncom-test-1")};
+    const int32_t SECOND{subscribe("@opendlv-device-gps-ncom-test-1")};
+    REQUIRE(0 <= FIRST);
+    REQUIRE(0 <= SECOND);
+    REQUIRE(waitFor(server, 2));
+
+    for (uint32_t i{0}; i < 3; i++) {
+        NavStateRecord r;
+        r.senderStamp = i;
+        r.sampleTime = 1000 + i;
+        r.latitude = 57.7;
+        r.heading = 1.5f;
+        server.add(r);
+    }
+    server.flush();
+
+    for (auto fd : {FIRST, SECOND}) {
+        NavStateRecord records[4];
+        const ssize_t LENGTH{::recv(fd, records, sizeof(records), 0)};
+        REQUIRE(3 * sizeof(NavStateRecord) == static_cast<std::size_t>(LENGTH));
+        for (uint32_t i{0}; i < 3; i++) {
+            REQUIRE(NavStateRecord::VERSION == records[i].version);
+            REQUIRE(i == records[i].senderStamp);
+            REQUIRE(1000 + i == records[i].sampleTime);
+            REQUIRE(57.7 == Approx(records[i].latitude));
+            REQUIRE(1.5f == Approx(records[i].heading));
+        }
+    }
+
+    // Closed subscribers are removed but not counted as dropped.
+    ::close(SECOND);
+    server.add(NavStateRecord());
+    server.flush();
+    REQUIRE(1 == server.subscribers());
+    REQUIRE(0 == server.dropped());
+    ::close(FIRST);
+}
+
+TEST_CASE("Test NavStateServer drops subscribers that do not keep up.") {
+    NavStateServer server{"@opendlv-device-gps-ncom-test-2"};
+    REQUIRE(server.isValid());
+    const int32_t SLOW{subscribe("@opendlv-device-gps-ncom-test-2")};
+    REQUIRE(0 <= SLOW);
+    REQUIRE(waitFor(server, 1));
+
+    // Never read until the socket buffer is full.
+    for (uint32_t i{0}; (i < 100000) && (1 == server.subscribers()); i++) {
+        server.add(NavStateRecord());
+    }
+    REQUIRE(0 == server.subscribers());
+    REQUIRE(1 == server.dropped());
+    ::close(SLOW);
+}
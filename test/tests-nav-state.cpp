@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+
+#include "cluon-complete.hpp"
+#include "opendlv-standard-message-set.hpp"
+
+#include "nav-state.hpp"
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+TEST_CASE("Test NavState attitude for pure yaw.") {
+    NavState state;
+    state.messages.heading.northHeading(static_cast<float>(M_PI) / 2.0f);
+    auto a = state.attitude();
+
+    // Body x (forward) points east.
+    REQUIRE(0.0f == Approx(a.r11()).margin(1e-6));
+    REQUIRE(1.0f == Approx(a.r21()));
+    REQUIRE(0.0f == Approx(a.r31()).margin(1e-6));
+    REQUIRE(1.0f == Approx(a.r33()));
+    REQUIRE(std::sqrt(0.5f) == Approx(a.qw()));
+    REQUIRE(std::sqrt(0.5f) == Approx(a.qz()));
+    REQUIRE(0.0f == Approx(a.qx()).margin(1e-6));
+    REQUIRE(0.0f == Approx(a.qy()).margin(1e-6));
+}
+
+TEST_CASE("Test NavState attitude quaternion matches rotation matrix.") {
+    NavState state;
+    state.messages.heading.northHeading(-2.1f);
+    state.messages.pitch = 0.3f;
+    state.messages.roll = -0.7f;
+    auto a = state.attitude();
+
+    REQUIRE(-2.1f == Approx(a.yaw()));
+    REQUIRE(0.3f == Approx(a.pitch()));
+    REQUIRE(-0.7f == Approx(a.roll()));
+
+    const float W{a.qw()};
+    const float X{a.qx()};
+    const float Y{a.qy()};
+    const float Z{a.qz()};
+    REQUIRE(1.0f == Approx(W * W + X * X + Y * Y + Z * Z));
+    REQUIRE(1.0f - 2.0f * (Y * Y + Z * Z) == Approx(a.r11()));
+    REQUIRE(2.0f * (X * Y - W * Z) == Approx(a.r12()));
+    REQUIRE(2.0f * (X * Z + W * Y) == Approx(a.r13()));
+    REQUIRE(2.0f * (X * Y + W * Z) == Approx(a.r21()));
+    REQUIRE(1.0f - 2.0f * (X * X + Z * Z) == Approx(a.r22()));
+    REQUIRE(2.0f * (Y * Z - W * X) == Approx(a.r23()));
+    REQUIRE(2.0f * (X * Z - W * Y) == Approx(a.r31()));
+    REQUIRE(2.0f * (Y * Z + W * X) == Approx(a.r32()));
+    REQUIRE(1.0f - 2.0f * (X * X + Y * Y) == Approx(a.r33()));
+    REQUIRE(-std::sin(0.3f) == Approx(a.r31()));
+}
+
+TEST_CASE("Test NavState record carries time stamps and values.") {
+    NavState state;
+    state.sampleTime.seconds(1000).microseconds(250000);
+    state.received.seconds(2000).microseconds(1);
+    state.senderStamp = 3;
+    state.messages.position.latitude(57.7).longitude(11.9);
+    state.messages.pitch = 0.1f;
+    state.messages.equilibrioception.vy(2.5f).vz(-0.5f);
+    state.messages.angularVelocity.angularVelocityZ(0.2f);
+    const NavStateRecord R{state.record()};
+
+    REQUIRE(1 == R.version);
+    REQUIRE(3 == R.senderStamp);
+    REQUIRE(1000250000 == R.sampleTime);
+    REQUIRE(2000000001 == R.received);
+    REQUIRE(57.7 == Approx(R.latitude));
+    REQUIRE(11.9 == Approx(R.longitude));
+    REQUIRE(0.1f == Approx(R.pitch));
+    // Equilibrioception is north, west, up.
+    REQUIRE(-2.5f == Approx(R.velocityEast));
+    REQUIRE(0.5f == Approx(R.velocityDown));
+    REQUIRE(0.2f == Approx(R.angularVelocityZ));
+}
+
+TEST_CASE("Test NavState velocities of a decoded packet are north, east, down.") {
+    // Sample packet moving 0.005m/s north, 0.0005m/s east, and 0.0044m/s down.
+    std::vector<uint8_t> sample{
+      0xe7, 0x9c, 0x95, 0x95, 0x08, 0x00, 0x7c, 0x0e,
+      0x00, 0x06, 0x81, 0xfe, 0x45, 0x00, 0x00, 0xf4,
+      0x00, 0x00, 0xaa, 0xff, 0xff, 0x04, 0xc2, 0x92,
+      0xf2, 0x9e, 0x60, 0x0a, 0x35, 0xf0, 0x3f, 0x46,
+      0x63, 0x83, 0x3b, 0x7c, 0x96, 0xcc, 0x3f, 0x23,
+      0x5a, 0xd0, 0x42, 0x32, 0x00, 0x00, 0x05, 0x00,
+      0x00, 0x2c, 0x00, 0x00, 0xeb, 0xae, 0xe0, 0x00,
+      0x59, 0x00, 0xbe, 0x6b, 0xff, 0xe4, 0x1d, 0x01,
+      0x00, 0x00, 0x00, 0xff, 0xff, 0x01, 0xff, 0xe4
+    };
+    const std::string DATA(reinterpret_cast<char*>(sample.data()), sample.size());
+    NCOMDecoder d;
+    auto retVal = d.decode(DATA);
+    REQUIRE(retVal.first);
+
+    NavState state;
+    state.messages = retVal.second;
+    auto msg = state.compound();
+    REQUIRE(0.005f == Approx(msg.velocityNorth()));
+    REQUIRE(0.0005f == Approx(msg.velocityEast()));
+    REQUIRE(0.0044f == Approx(msg.velocityDown()));
+    const NavStateRecord R{state.record()};
+    REQUIRE(0.005f == Approx(R.velocityNorth));
+    REQUIRE(0.0005f == Approx(R.velocityEast));
+    REQUIRE(0.0044f == Approx(R.velocityDown));
+}
@@ -85,14 +85,14 @@ TEST_CASE("Test NCOMDecoder with sample payload.") {
     REQUIRE(58.037722605 == Approx(msg3.latitude()));
     REQUIRE(12.796579564 == Approx(msg3.longitude()));
 
-    REQUIRE(2.1584727764 == Approx(msg4.northHeading()));
+    REQUIRE(-2.052373 == Approx(msg4.northHeading()));
 
     REQUIRE(0.0000999998 == Approx(msg5.groundSpeed()));
 
     REQUIRE(104.176 == Approx(msg6.altitude()));
 
     REQUIRE(0.022784 == Approx(msgs.pitch));
-    REQUIRE(-2.1103 == Approx(msgs.roll));
+    REQUIRE(-0.037954 == Approx(msgs.roll));
 
     REQUIRE(msg7.latitude() == Approx(msg3.latitude()));
     REQUIRE(msg7.longitude() == Approx(msg3.longitude()));
@@ -100,6 +100,33 @@ TEST_CASE("Test NCOMDecoder with sample payload.") {
     REQUIRE(msg7.altitude() == Approx(msg6.altitude()));
 }
 
+TEST_CASE("Test NCOMDecoder with negative heading, pitch, and roll.") {
+    // Sample payload with its pitch negated (bytes 55-57) and checksums 2 and 3 updated.
+    std::vector<uint8_t> sample{
+      0xe7, 0x9c, 0x95, 0x95, 0x08, 0x00, 0x7c, 0x0e,
+      0x00, 0x06, 0x81, 0xfe, 0x45, 0x00, 0x00, 0xf4,
+      0x00, 0x00, 0xaa, 0xff, 0xff, 0x04, 0xc2, 0x92,
+      0xf2, 0x9e, 0x60, 0x0a, 0x35, 0xf0, 0x3f, 0x46,
+      0x63, 0x83, 0x3b, 0x7c, 0x96, 0xcc, 0x3f, 0x23,
+      0x5a, 0xd0, 0x42, 0x32, 0x00, 0x00, 0x05, 0x00,
+      0x00, 0x2c, 0x00, 0x00, 0xeb, 0xae, 0xe0, 0x00,
+      0xa7, 0xff, 0xbe, 0x6b, 0xff, 0x31, 0x1d, 0x01,
+      0x00, 0x00, 0x00, 0xff, 0xff, 0x01, 0xff, 0x7e
+    };
+
+    const std::string DATA(reinterpret_cast<char*>(sample.data()), sample.size());
+
+    NCOMDecoder d;
+    auto retVal = d.decode(DATA);
+
+    REQUIRE(retVal.first);
+    // 24-bit two's complement in 1e-6 rad, not wrapped into range.
+    REQUIRE(-2.052373 == Approx(retVal.second.heading.northHeading()));
+    REQUIRE(-2.052373 == Approx(retVal.second.geolocation.heading()));
+    REQUIRE(-0.022784 == Approx(retVal.second.pitch));
+    REQUIRE(-0.037954 == Approx(retVal.second.roll));
+}
+
 TEST_CASE("Test NCOMDecoder with sample payload and channel 0 for time stamp.") {
     std::vector<uint8_t> sample{
         0xe7, 0xfd, 0x55, 0x1a, 0x0b, 0x00, 0x9e, 0x04,
@@ -126,3 +153,57 @@ TEST_CASE("Test NCOMDecoder with sample payload and channel 0 for time stamp.")
     REQUIRE(13000 == msgs.sampleTime.microseconds());
 }
 
+
+TEST_CASE("Test NCOMDecoder collects status from the status channels.") {
+    std::vector<uint8_t> sample{
+      0xe7, 0x9c, 0x95, 0x95, 0x08, 0x00, 0x7c, 0x0e,
+      0x00, 0x06, 0x81, 0xfe, 0x45, 0x00, 0x00, 0xf4,
+      0x00, 0x00, 0xaa, 0xff, 0xff, 0x04, 0xc2, 0x92,
+      0xf2, 0x9e, 0x60, 0x0a, 0x35, 0xf0, 0x3f, 0x46,
+      0x63, 0x83, 0x3b, 0x7c, 0x96, 0xcc, 0x3f, 0x23,
+      0x5a, 0xd0, 0x42, 0x32, 0x00, 0x00, 0x05, 0x00,
+      0x00, 0x2c, 0x00, 0x00, 0xeb, 0xae, 0xe0, 0x00,
+      0x59, 0x00, 0xbe, 0x6b, 0xff, 0xe4, 0x1d, 0x01,
+      0x00, 0x00, 0x00, 0xff, 0xff, 0x01, 0xff, 0xe4
+    };
+
+    NCOMDecoder d;
+    auto retVal = d.decode(std::string(reinterpret_cast<char*>(sample.data()), sample.size()));
+    REQUIRE(retVal.first);
+    REQUIRE(4 == retVal.second.status.navigationStatus());
+    REQUIRE(0 == retVal.second.status.satellites());
+
+    // Channel 0: GPS minutes, satellites, and modes.
+    std::vector<uint8_t> channel0{sample};
+    channel0[62] = 0;
+    channel0[63] = 0x10; channel0[64] = 0x27; channel0[65] = 0x00; channel0[66] = 0x00;
+    channel0[67] = 12;
+    channel0[68] = 5;
+    channel0[69] = 6;
+    channel0[70] = 7;
+    retVal = d.decode(std::string(reinterpret_cast<char*>(channel0.data()), channel0.size()));
+    REQUIRE(12 == retVal.second.status.satellites());
+    REQUIRE(5 == retVal.second.status.positionMode());
+    REQUIRE(6 == retVal.second.status.velocityMode());
+    REQUIRE(7 == retVal.second.status.orientationMode());
+
+    // Channel 3: Position accuracy in mm; kept while other channels follow.
+    std::vector<uint8_t> channel3{sample};
+    channel3[62] = 3;
+    channel3[63] = 0x2c; channel3[64] = 0x01;
+    channel3[65] = 0x64; channel3[66] = 0x00;
+    channel3[67] = 0xe8; channel3[68] = 0x03;
+    channel3[69] = 10;
+    retVal = d.decode(std::string(reinterpret_cast<char*>(channel3.data()), channel3.size()));
+    retVal = d.decode(std::string(reinterpret_cast<char*>(sample.data()), sample.size()));
+    REQUIRE(0.3f == Approx(retVal.second.status.northAccuracy()));
+    REQUIRE(0.1f == Approx(retVal.second.status.eastAccuracy()));
+    REQUIRE(1.0f == Approx(retVal.second.status.downAccuracy()));
+    REQUIRE(12 == retVal.second.status.satellites());
+
+    // Too old accuracies are ignored.
+    channel3[63] = 0xff;
+    channel3[69] = 200;
+    retVal = d.decode(std::string(reinterpret_cast<char*>(channel3.data()), channel3.size()));
+    REQUIRE(0.3f == Approx(retVal.second.status.northAccuracy()));
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+
+#include "ncom-file-reader.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+const std::vector<uint8_t> SAMPLE{
+  0xe7, 0x9c, 0x95, 0x95, 0x08, 0x00, 0x7c, 0x0e,
+  0x00, 0x06, 0x81, 0xfe, 0x45, 0x00, 0x00, 0xf4,
+  0x00, 0x00, 0xaa, 0xff, 0xff, 0x04, 0xc2, 0x92,
+  0xf2, 0x9e, 0x60, 0x0a, 0x35, 0xf0, 0x3f, 0x46,
+  0x63, 0x83, 0x3b, 0x7c, 0x96, 0xcc, 0x3f, 0x23,
+  0x5a, 0xd0, 0x42, 0x32, 0x00, 0x00, 0x05, 0x00,
+  0x00, 0x2c, 0x00, 0x00, 0xeb, 0xae, 0xe0, 0x00,
+  0x59, 0x00, 0xbe, 0x6b, 0xff, 0xe4, 0x1d, 0x01,
+  0x00, 0x00, 0x00, 0xff, 0xff, 0x01, 0xff, 0xe4
+};
+
+// Sample packet with the given milliseconds into the GPS minute.
+std::string packetAt(uint16_t millisecondsIntoMinute) {
+    std::string packet(SAMPLE.begin(), SAMPLE.end());
+    packet[1] = static_cast<char>(millisecondsIntoMinute & 0xFF);
+    packet[2] = static_cast<char>(millisecondsIntoMinute >> 8);
+    uint8_t sum{0};
+    for (std::size_t i{1}; i < 71; i++) {
+        if ( (22 == i) || (61 == i) ) {
+            packet[i] = static_cast<char>(sum);
+        }
+        sum = static_cast<uint8_t>(sum + static_cast<uint8_t>(packet[i]));
+    }
+    packet[71] = static_cast<char>(sum);
+    return packet;
+}
+}
+
+TEST_CASE("Test NCOMFileReader with a missing file.") {
+    NCOMFileReader r("/nonexisting/file.ncom", NCOMFileReader::Pacing::MAX_SPEED, nullptr);
+    REQUIRE(!r.isValid());
+    REQUIRE(!r.isRunning());
+}
+
+TEST_CASE("Test NCOMFileReader reads a file at maximum speed.") {
+    const std::string FILENAME{"/tmp/tests-ncom-file-reader.ncom"};
+    {
+        std::ofstream out(FILENAME, std::ios::binary | std::ios::trunc);
+        out << "garbage";
+        for (uint32_t i{0}; i < 10000; i++) {
+            out << packetAt(static_cast<uint16_t>((i * 10) % 60000));
+        }
+    }
+
+    std::atomic<uint32_t> received{0};
+    NCOMFileReader r(FILENAME, NCOMFileReader::Pacing::MAX_SPEED, [&received](std::size_t, const char *, std::size_t length, const std::chrono::system_clock::time_point &) {
+        if (72 == length) {
+            received++;
+        }
+    });
+    for (uint32_t i{0}; r.isRunning() && (i < 500); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    }
+    REQUIRE(!r.isRunning());
+    // Reaching the end of the input is no error.
+    REQUIRE(r.isValid());
+    REQUIRE(10000 == received.load());
+    REQUIRE(10000 == r.packets());
+    REQUIRE(7 == r.discardedBytes());
+    ::unlink(FILENAME.c_str());
+}
+
+TEST_CASE("Test NCOMFileReader reads from a named pipe paced by GPS time.") {
+    const std::string FIFO{"/tmp/tests-ncom-file-reader.fifo"};
+    ::unlink(FIFO.c_str());
+    REQUIRE(0 == ::mkfifo(FIFO.c_str(), 0600));
+
+    // 11 packets 20ms apart, crossing a GPS minute.
+    bool written{false};
+    std::thread writer([&FIFO, &written]() {
+        const int fd{::open(FIFO.c_str(), O_WRONLY)};
+        std::string stream;
+        for (uint32_t i{0}; i < 11; i++) {
+            stream += packetAt(static_cast<uint16_t>((59900 + i * 20) % 60000));
+        }
+        // Write unaligned to packet boundaries.
+        written = (100 == ::write(fd, stream.data(), 100));
+        written &= (static_cast<ssize_t>(stream.size() - 100) == ::write(fd, stream.data() + 100, stream.size() - 100));
+        ::close(fd);
+    });
+
+    std::vector<std::chrono::steady_clock::time_point> handedOver;
+    NCOMFileReader r(FIFO, NCOMFileReader::Pacing::GPS_TIME, [&handedOver](std::size_t, const char *, std::size_t, const std::chrono::system_clock::time_point &) {
+        handedOver.push_back(std::chrono::steady_clock::now());
+    });
+    writer.join();
+    REQUIRE(written);
+    for (uint32_t i{0}; r.isRunning() && (i < 500); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    }
+    REQUIRE(!r.isRunning());
+    REQUIRE(11 == handedOver.size());
+
+    const int64_t DURATION{std::chrono::duration_cast<std::chrono::milliseconds>(handedOver.back() - handedOver.front()).count()};
+    REQUIRE(200 <= DURATION);
+    REQUIRE(400 > DURATION);
+    ::unlink(FIFO.c_str());
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+
+#include "ncom-framer.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace {
+const std::vector<uint8_t> SAMPLE{
+  0xe7, 0x9c, 0x95, 0x95, 0x08, 0x00, 0x7c, 0x0e,
+  0x00, 0x06, 0x81, 0xfe, 0x45, 0x00, 0x00, 0xf4,
+  0x00, 0x00, 0xaa, 0xff, 0xff, 0x04, 0xc2, 0x92,
+  0xf2, 0x9e, 0x60, 0x0a, 0x35, 0xf0, 0x3f, 0x46,
+  0x63, 0x83, 0x3b, 0x7c, 0x96, 0xcc, 0x3f, 0x23,
+  0x5a, 0xd0, 0x42, 0x32, 0x00, 0x00, 0x05, 0x00,
+  0x00, 0x2c, 0x00, 0x00, 0xeb, 0xae, 0xe0, 0x00,
+  0x59, 0x00, 0xbe, 0x6b, 0xff, 0xe4, 0x1d, 0x01,
+  0x00, 0x00, 0x00, 0xff, 0xff, 0x01, 0xff, 0xe4
+};
+}
+
+TEST_CASE("Test NCOMFramer validates sync byte and checksums.") {
+    const std::string PACKET(SAMPLE.begin(), SAMPLE.end());
+    REQUIRE(NCOMFramer::isValid(PACKET.data()));
+
+    for (std::size_t i : {0, 5, 22, 40, 61, 66, 71}) {
+        std::string corrupted{PACKET};
+        corrupted[i] = static_cast<char>(corrupted[i] ^ 0x01);
+        REQUIRE(!NCOMFramer::isValid(corrupted.data()));
+    }
+}
+
+TEST_CASE("Test NCOMFramer finds packets in a byte stream fed in chunks.") {
+    const std::string PACKET(SAMPLE.begin(), SAMPLE.end());
+    std::string corrupted{PACKET};
+    corrupted[30] = static_cast<char>(corrupted[30] ^ 0x10);
+
+    // Leading garbage with a false sync byte, two packets back to back, a
+    // corrupted packet, and a final packet.
+    const std::string STREAM{std::string("ab\xe7" "cd") + PACKET + PACKET + corrupted + PACKET};
+
+    for (std::size_t chunk : {1, 7, 71, 72, 100, 1000}) {
+        std::vector<std::string> packets;
+        NCOMFramer framer([&packets](const char *data, std::size_t length) {
+            packets.emplace_back(data, length);
+        });
+        for (std::size_t i{0}; i < STREAM.size(); i += chunk) {
+            const std::size_t N{(i + chunk < STREAM.size()) ? chunk : STREAM.size() - i};
+            framer.feed(STREAM.data() + i, N);
+        }
+
+        REQUIRE(3 == packets.size());
+        for (const auto &p : packets) {
+            REQUIRE(PACKET == p);
+        }
+        REQUIRE(5 + NCOMFramer::PACKET_LENGTH == framer.discardedBytes());
+    }
+}
+
+TEST_CASE("Test NCOMFramer hands over complete packets in place.") {
+    const std::string STREAM(SAMPLE.begin(), SAMPLE.end());
+    const char *delivered{nullptr};
+    NCOMFramer framer([&delivered](const char *data, std::size_t) {
+        delivered = data;
+    });
+    framer.feed(STREAM.data(), STREAM.size());
+    REQUIRE(STREAM.data() == delivered);
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+
+#include "cluon-complete.hpp"
+
+#include "ncom-packet-capture.hpp"
+#include "ncom-relay.hpp"
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("Test NCOMPacketCapture captures datagrams for the given units once.") {
+    using namespace std::literals::chrono_literals;
+    auto units = NCOMUDPReceiver::parseUnits("127.0.0.1:43011:1,0.0.0.0:43012:2");
+
+    std::mutex m;
+    std::vector<std::pair<std::size_t, std::string>> received;
+    NCOMPacketCapture c("lo", units, [&](std::size_t unit, const char *data, std::size_t length, const std::chrono::system_clock::time_point &) {
+        std::lock_guard<std::mutex> lck(m);
+        received.emplace_back(unit, std::string(data, length));
+    });
+    if (!c.isRunning()) {
+        WARN("Skipping: Capturing from lo requires CAP_NET_RAW.");
+        return;
+    }
+
+    cluon::UDPSender s1{"127.0.0.1", 43011};
+    cluon::UDPSender s2{"127.0.0.1", 43012};
+    cluon::UDPSender s3{"127.0.0.1", 43013};
+    s3.send("Not for us");
+    s1.send("Unit one");
+    s2.send("Unit two");
+
+    // Blocks are retired by the kernel after a timeout when not full.
+    for (uint32_t i{0}; i < 100; i++) {
+        {
+            std::lock_guard<std::mutex> lck(m);
+            if (2 <= received.size()) {
+                break;
+            }
+        }
+        std::this_thread::sleep_for(10ms);
+    }
+    std::this_thread::sleep_for(50ms);
+
+    std::lock_guard<std::mutex> lck(m);
+    REQUIRE(2 == received.size());
+    REQUIRE(0 == received[0].first);
+    REQUIRE("Unit one" == received[0].second);
+    REQUIRE(1 == received[1].first);
+    REQUIRE("Unit two" == received[1].second);
+}
+
+TEST_CASE("Test NCOMPacketCapture forwards captured datagrams to a tee destination.") {
+    using namespace std::literals::chrono_literals;
+    std::mutex m;
+    std::vector<std::string> forwarded;
+    cluon::UDPReceiver destination{"127.0.0.1", 43015, [&m, &forwarded](std::string &&data, std::string &&, std::chrono::system_clock::time_point &&) {
+        std::lock_guard<std::mutex> lck(m);
+        forwarded.push_back(data);
+    }};
+
+    NCOMRelay tee{"127.0.0.1:43015"};
+    REQUIRE(tee.isValid());
+    NCOMPacketCapture c("lo", NCOMUDPReceiver::parseUnits("127.0.0.1:43014:1"), nullptr, &tee);
+    if (!c.isRunning()) {
+        WARN("Skipping: Capturing from lo requires CAP_NET_RAW.");
+        return;
+    }
+
+    cluon::UDPSender s{"127.0.0.1", 43014};
+    s.send("Unit one");
+
+    // Blocks are retired by the kernel after a timeout when not full.
+    for (uint32_t i{0}; i < 100; i++) {
+        {
+            std::lock_guard<std::mutex> lck(m);
+            if (1 <= forwarded.size()) {
+                break;
+            }
+        }
+        std::this_thread::sleep_for(10ms);
+    }
+
+    std::lock_guard<std::mutex> lck(m);
+    REQUIRE(1 == forwarded.size());
+    REQUIRE("Unit one" == forwarded[0]);
+    REQUIRE(1 == tee.forwarded());
+}
@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+
+#include "ncom-recorder.hpp"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+class Replayed {
+   public:
+    uint32_t senderStamp;
+    std::string data;
+    int64_t received;
+};
+
+std::vector<Replayed> replay(const std::string &filename) {
+    std::vector<Replayed> replayed;
+    NCOMRecorder::replay(filename, [&replayed](uint32_t senderStamp, const char *data, std::size_t length, const std::chrono::system_clock::time_point &tp) {
+        replayed.push_back(Replayed{senderStamp, std::string(data, length), std::chrono::duration_cast<std::chrono::microseconds>(tp.time_since_epoch()).count()});
+    });
+    return replayed;
+}
+
+// NCOM-sized packet with its number in the first byte.
+std::string packet(uint32_t i) {
+    return std::string(1, static_cast<char>(i)) + std::string(71, 'N');
+}
+
+std::chrono::system_clock::time_point at(int64_t microseconds) {
+    return std::chrono::system_clock::time_point(std::chrono::microseconds(microseconds));
+}
+
+// Offset of a recorded 72-byte packet: file header and record header, packet, and trailer.
+std::streamoff offsetOf(uint32_t i) {
+    return 64 + i * (24 + 72 + 8);
+}
+}
+
+TEST_CASE("Test NCOMRecorder does not overwrite other files.") {
+    const std::string FILENAME{"/tmp/tests-ncom-recorder-other.txt"};
+    {
+        std::ofstream out(FILENAME, std::ios::binary | std::ios::trunc);
+        out << "Not an NCOM recording.";
+    }
+    REQUIRE(!NCOMRecorder(FILENAME, 1024 * 1024, std::chrono::milliseconds(100)).isValid());
+    struct stat info{};
+    REQUIRE(0 == ::stat(FILENAME.c_str(), &info));
+    REQUIRE(22 == info.st_size);
+    REQUIRE(0 == NCOMRecorder::replay(FILENAME, nullptr));
+    ::unlink(FILENAME.c_str());
+
+    REQUIRE(!NCOMRecorder("/nonexisting/directory/recording", 1024 * 1024, std::chrono::milliseconds(100)).isValid());
+}
+
+TEST_CASE("Test NCOMRecorder records packets to a preallocated file.") {
+    const std::string FILENAME{"/tmp/tests-ncom-recorder.rec"};
+    ::unlink(FILENAME.c_str());
+    {
+        NCOMRecorder recorder{FILENAME, 1024 * 1024, std::chrono::milliseconds(100)};
+        REQUIRE(recorder.isValid());
+        for (uint32_t i{0}; i < 100; i++) {
+            const std::string PACKET{packet(i)};
+            REQUIRE(recorder.add(PACKET.data(), PACKET.size(), i % 2, at(1000000 + i)));
+        }
+        const std::string TOO_LONG(NCOMRecorder::MAX_PACKET + 1, 'N');
+        REQUIRE(!recorder.add(TOO_LONG.data(), TOO_LONG.size(), 0, at(0)));
+        REQUIRE(1 == recorder.dropped());
+
+        // Packets are synced periodically, not only when stopping.
+        for (uint32_t i{0}; (i < 100) && (100 != replay(FILENAME).size()); i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        REQUIRE(100 == replay(FILENAME).size());
+        REQUIRE(100 == recorder.recorded());
+    }
+    struct stat info{};
+    REQUIRE(0 == ::stat(FILENAME.c_str(), &info));
+    REQUIRE(1024 * 1024 == info.st_size);
+
+    const std::vector<Replayed> REPLAYED{replay(FILENAME)};
+    REQUIRE(100 == REPLAYED.size());
+    for (uint32_t i{0}; i < 100; i++) {
+        REQUIRE(i % 2 == REPLAYED[i].senderStamp);
+        REQUIRE(packet(i) == REPLAYED[i].data);
+        REQUIRE(1000000 + i == REPLAYED[i].received);
+    }
+    ::unlink(FILENAME.c_str());
+}
+
+TEST_CASE("Test NCOMRecorder continues after the valid records of an interrupted recording.") {
+    const std::string FILENAME{"/tmp/tests-ncom-recorder-interrupted.rec"};
+    ::unlink(FILENAME.c_str());
+    {
+        NCOMRecorder recorder{FILENAME, 1024 * 1024, std::chrono::milliseconds(100)};
+        REQUIRE(recorder.isValid());
+        for (uint32_t i{0}; i < 3; i++) {
+            const std::string PACKET{packet(i)};
+            recorder.add(PACKET.data(), PACKET.size(), 0, at(i));
+        }
+    }
+    REQUIRE(3 == replay(FILENAME).size());
+
+    // Lose a part of the second packet as if the power failed before it was synced.
+    {
+        std::fstream file(FILENAME, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(offsetOf(1) + 24 + 10);
+        file.put('X');
+    }
+    REQUIRE(1 == replay(FILENAME).size());
+
+    // The next recording overwrites the second packet, and the third one
+    // from the previous recording is not taken for a new one.
+    {
+        NCOMRecorder recorder{FILENAME, 1024 * 1024, std::chrono::milliseconds(100)};
+        REQUIRE(recorder.isValid());
+        const std::string PACKET{packet(10)};
+        recorder.add(PACKET.data(), PACKET.size(), 1, at(10));
+    }
+    const std::vector<Replayed> REPLAYED{replay(FILENAME)};
+    REQUIRE(2 == REPLAYED.size());
+    REQUIRE(packet(0) == REPLAYED[0].data);
+    REQUIRE(packet(10) == REPLAYED[1].data);
+    REQUIRE(1 == REPLAYED[1].senderStamp);
+    ::unlink(FILENAME.c_str());
+}
+
+TEST_CASE("Test NCOMRecorder drops packets when the file is full.") {
+    const std::string FILENAME{"/tmp/tests-ncom-recorder-full.rec"};
+    ::unlink(FILENAME.c_str());
+    {
+        NCOMRecorder recorder{FILENAME, static_cast<uint64_t>(offsetOf(10)), std::chrono::milliseconds(100)};
+        REQUIRE(recorder.isValid());
+        for (uint32_t i{0}; i < 20; i++) {
+            const std::string PACKET{packet(i)};
+            recorder.add(PACKET.data(), PACKET.size(), 0, at(i));
+        }
+        for (uint32_t i{0}; (i < 100) && (20 != recorder.recorded() + recorder.dropped()); i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        REQUIRE(10 == recorder.recorded());
+        REQUIRE(10 == recorder.dropped());
+    }
+    REQUIRE(10 == replay(FILENAME).size());
+
+    // A full recording cannot be continued without growing it.
+    REQUIRE(!NCOMRecorder(FILENAME, static_cast<uint64_t>(offsetOf(10)), std::chrono::milliseconds(100)).isValid());
+    REQUIRE(NCOMRecorder(FILENAME, static_cast<uint64_t>(offsetOf(20)), std::chrono::milliseconds(100)).isValid());
+    REQUIRE(10 == replay(FILENAME).size());
+    ::unlink(FILENAME.c_str());
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+
+#include "cluon-complete.hpp"
+
+#include "ncom-relay.hpp"
+#include "ncom-udp-receiver.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("Test NCOMRelay rejects malformed destinations.") {
+    REQUIRE(!NCOMRelay("").isValid());
+    REQUIRE(!NCOMRelay("127.0.0.1").isValid());
+    REQUIRE(!NCOMRelay("localhost:3000").isValid());
+    REQUIRE(!NCOMRelay("127.0.0.1:3000,,239.1.2.3:3001").isValid());
+    REQUIRE(NCOMRelay("127.0.0.1:3000, 239.1.2.3:3001").isValid());
+}
+
+TEST_CASE("Test NCOMUDPReceiver forwards all datagrams to each tee destination.") {
+    using namespace std::literals::chrono_literals;
+    constexpr uint32_t DATAGRAMS{100};
+
+    std::mutex m;
+    std::vector<std::string> atFirst;
+    std::vector<std::string> atSecond;
+    cluon::UDPReceiver first{"127.0.0.1", 43042, [&m, &atFirst](std::string &&data, std::string &&, std::chrono::system_clock::time_point &&) {
+        std::lock_guard<std::mutex> lck(m);
+        atFirst.push_back(data);
+    }};
+    cluon::UDPReceiver second{"127.0.0.1", 43043, [&m, &atSecond](std::string &&data, std::string &&, std::chrono::system_clock::time_point &&) {
+        std::lock_guard<std::mutex> lck(m);
+        atSecond.push_back(data);
+    }};
+
+    NCOMRelay tee{"127.0.0.1:43042,127.0.0.1:43043"};
+    REQUIRE(tee.isValid());
+    std::atomic<uint32_t> decoded{0};
+    NCOMUDPReceiver r(NCOMUDPReceiver::parseUnits("127.0.0.1:43041:0"),
+        [&decoded](std::size_t, const char *, std::size_t, const std::chrono::system_clock::time_point &) { decoded++; },
+        NCOMUDPReceiver::Backend::EPOLL, &tee);
+    REQUIRE(r.isRunning());
+
+    cluon::UDPSender sender{"127.0.0.1", 43041};
+    for (uint32_t i{0}; i < DATAGRAMS; i++) {
+        sender.send("NCOM " + std::to_string(i));
+    }
+
+    for (uint32_t i{0}; i < 100; i++) {
+        {
+            std::lock_guard<std::mutex> lck(m);
+            if ( (DATAGRAMS == atFirst.size()) && (DATAGRAMS == atSecond.size()) ) {
+                break;
+            }
+        }
+        std::this_thread::sleep_for(10ms);
+    }
+
+    std::lock_guard<std::mutex> lck(m);
+    REQUIRE(DATAGRAMS == decoded.load());
+    REQUIRE(DATAGRAMS == atFirst.size());
+    REQUIRE(DATAGRAMS == atSecond.size());
+    REQUIRE("NCOM 0" == atFirst.front());
+    REQUIRE("NCOM 99" == atSecond.back());
+    REQUIRE(2 * DATAGRAMS == tee.forwarded());
+    REQUIRE(0 == tee.dropped());
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+
+#include "cluon-complete.hpp"
+#include "opendlv-standard-message-set.hpp"
+
+#include "ncom-decoder.hpp"
+#include "ncom-serial-receiver.hpp"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("Test NCOMSerialReceiver decodes NCOM from a pseudo terminal and measure latency to OD4.") {
+    using namespace std::literals::chrono_literals;
+    const std::vector<uint8_t> SAMPLE{
+      0xe7, 0x9c, 0x95, 0x95, 0x08, 0x00, 0x7c, 0x0e,
+      0x00, 0x06, 0x81, 0xfe, 0x45, 0x00, 0x00, 0xf4,
+      0x00, 0x00, 0xaa, 0xff, 0xff, 0x04, 0xc2, 0x92,
+      0xf2, 0x9e, 0x60, 0x0a, 0x35, 0xf0, 0x3f, 0x46,
+      0x63, 0x83, 0x3b, 0x7c, 0x96, 0xcc, 0x3f, 0x23,
+      0x5a, 0xd0, 0x42, 0x32, 0x00, 0x00, 0x05, 0x00,
+      0x00, 0x2c, 0x00, 0x00, 0xeb, 0xae, 0xe0, 0x00,
+      0x59, 0x00, 0xbe, 0x6b, 0xff, 0xe4, 0x1d, 0x01,
+      0x00, 0x00, 0x00, 0xff, 0xff, 0x01, 0xff, 0xe4
+    };
+
+    const int master{::posix_openpt(O_RDWR | O_NOCTTY)};
+    REQUIRE(0 <= master);
+    REQUIRE(0 == ::grantpt(master));
+    REQUIRE(0 == ::unlockpt(master));
+    const std::string SLAVE{::ptsname(master)};
+
+    // Path under test: serial bytes -> framing -> decoding -> OD4 envelope.
+    std::mutex m;
+    std::vector<std::chrono::steady_clock::time_point> published;
+    std::vector<opendlv::proxy::GeodeticWgs84Reading> positions;
+    cluon::OD4Session receiver{197, [&m, &published, &positions](cluon::data::Envelope &&envelope) {
+        if (opendlv::proxy::GeodeticWgs84Reading::ID() == envelope.dataType()) {
+            std::lock_guard<std::mutex> lck(m);
+            published.push_back(std::chrono::steady_clock::now());
+            positions.push_back(cluon::extractMessage<opendlv::proxy::GeodeticWgs84Reading>(std::move(envelope)));
+        }
+    }};
+    cluon::OD4Session sender{197};
+
+    NCOMDecoder decoder;
+    NCOMSerialReceiver r(SLAVE, 230400, [&decoder, &sender](std::size_t, const char *data, std::size_t length, const std::chrono::system_clock::time_point &) {
+        auto retVal = decoder.decode(data, length);
+        if (retVal.first) {
+            sender.send(retVal.second.position);
+        }
+    });
+    REQUIRE(r.isRunning());
+    std::this_thread::sleep_for(100ms);
+
+    // Write each packet in two parts to exercise framing across reads.
+    constexpr std::size_t PACKETS{50};
+    std::vector<std::chrono::steady_clock::time_point> written;
+    for (std::size_t i{0}; i < PACKETS; i++) {
+        written.push_back(std::chrono::steady_clock::now());
+        REQUIRE(30 == ::write(master, SAMPLE.data(), 30));
+        REQUIRE(static_cast<ssize_t>(SAMPLE.size() - 30) == ::write(master, SAMPLE.data() + 30, SAMPLE.size() - 30));
+        std::this_thread::sleep_for(5ms);
+    }
+    for (uint32_t i{0}; i < 100; i++) {
+        {
+            std::lock_guard<std::mutex> lck(m);
+            if (PACKETS == published.size()) {
+                break;
+            }
+        }
+        std::this_thread::sleep_for(10ms);
+    }
+
+    std::lock_guard<std::mutex> lck(m);
+    REQUIRE(PACKETS == published.size());
+    REQUIRE(0 == r.discardedBytes());
+    for (auto &p : positions) {
+        REQUIRE(58.037722605 == Approx(p.latitude()));
+        REQUIRE(12.796579564 == Approx(p.longitude()));
+    }
+
+    // Reported only; a bound on it would depend on the load of the machine.
+    std::vector<int64_t> latencies;
+    for (std::size_t i{0}; i < PACKETS; i++) {
+        latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(published[i] - written[i]).count());
+    }
+    std::sort(latencies.begin(), latencies.end());
+    std::stringstream sstr;
+    sstr << "Serial byte to OD4 publish latency: median " << latencies[PACKETS / 2] << "us, max " << latencies.back() << "us.";
+    WARN(sstr.str());
+
+    ::close(master);
+}
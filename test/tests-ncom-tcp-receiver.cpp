@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+
+#include "ncom-tcp-receiver.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+const std::vector<uint8_t> SAMPLE{
+  0xe7, 0x9c, 0x95, 0x95, 0x08, 0x00, 0x7c, 0x0e,
+  0x00, 0x06, 0x81, 0xfe, 0x45, 0x00, 0x00, 0xf4,
+  0x00, 0x00, 0xaa, 0xff, 0xff, 0x04, 0xc2, 0x92,
+  0xf2, 0x9e, 0x60, 0x0a, 0x35, 0xf0, 0x3f, 0x46,
+  0x63, 0x83, 0x3b, 0x7c, 0x96, 0xcc, 0x3f, 0x23,
+  0x5a, 0xd0, 0x42, 0x32, 0x00, 0x00, 0x05, 0x00,
+  0x00, 0x2c, 0x00, 0x00, 0xeb, 0xae, 0xe0, 0x00,
+  0x59, 0x00, 0xbe, 0x6b, 0xff, 0xe4, 0x1d, 0x01,
+  0x00, 0x00, 0x00, 0xff, 0xff, 0x01, 0xff, 0xe4
+};
+
+int32_t listenOn(uint16_t port) {
+    int32_t s = ::socket(AF_INET, SOCK_STREAM, 0);
+    const int YES{1};
+    ::setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &YES, sizeof(YES));
+    struct sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if ( (0 > ::bind(s, reinterpret_cast<struct sockaddr *>(&address), sizeof(address))) || (0 > ::listen(s, 1)) ) {
+        ::close(s);
+        return -1;
+    }
+    return s;
+}
+}
+
+TEST_CASE("Test NCOMTCPReceiver frames partial reads and reconnects.") {
+    using namespace std::literals::chrono_literals;
+    const std::string PACKET(SAMPLE.begin(), SAMPLE.end());
+
+    std::mutex m;
+    std::vector<std::string> received;
+    NCOMTCPReceiver r("127.0.0.1", 43031, [&m, &received](std::size_t, const char *data, std::size_t length, const std::chrono::system_clock::time_point &) {
+        std::lock_guard<std::mutex> lck(m);
+        received.emplace_back(data, length);
+    }, 200ms);
+    REQUIRE(r.isRunning());
+
+    // The gateway is not up yet: The client has to keep retrying.
+    std::this_thread::sleep_for(300ms);
+    REQUIRE(!r.isConnected());
+
+    const int32_t server{listenOn(43031)};
+    REQUIRE(0 <= server);
+
+    // First connection: Three packets trickling in with odd segment sizes,
+    // then the connection drops in the middle of a fourth packet.
+    {
+        const int32_t c{::accept(server, nullptr, nullptr)};
+        REQUIRE(0 <= c);
+        const int YES{1};
+        ::setsockopt(c, IPPROTO_TCP, TCP_NODELAY, &YES, sizeof(YES));
+        const std::string STREAM{PACKET + PACKET + PACKET + PACKET.substr(0, 40)};
+        for (std::size_t i{0}; i < STREAM.size(); i += 13) {
+            const std::size_t N{(i + 13 < STREAM.size()) ? 13 : STREAM.size() - i};
+            REQUIRE(static_cast<ssize_t>(N) == ::send(c, STREAM.data() + i, N, MSG_NOSIGNAL));
+            std::this_thread::sleep_for(1ms);
+        }
+        std::this_thread::sleep_for(50ms);
+        ::close(c);
+    }
+
+    // Second connection: Many packets in one go.
+    {
+        const int32_t c{::accept(server, nullptr, nullptr)};
+        REQUIRE(0 <= c);
+        std::string stream;
+        for (uint32_t i{0}; i < 1000; i++) {
+            stream += PACKET;
+        }
+        REQUIRE(static_cast<ssize_t>(stream.size()) == ::send(c, stream.data(), stream.size(), MSG_NOSIGNAL));
+
+        for (uint32_t i{0}; i < 100; i++) {
+            {
+                std::lock_guard<std::mutex> lck(m);
+                if (1003 == received.size()) {
+                    break;
+                }
+            }
+            std::this_thread::sleep_for(10ms);
+        }
+        ::close(c);
+    }
+    ::close(server);
+
+    std::lock_guard<std::mutex> lck(m);
+    REQUIRE(1003 == received.size());
+    bool allEqual{true};
+    for (const auto &p : received) {
+        allEqual &= (PACKET == p);
+    }
+    REQUIRE(allEqual);
+    REQUIRE(2 <= r.connections());
+    REQUIRE(40 == r.discardedBytes());
+}
+
+TEST_CASE("Test NCOMTCPReceiver backs off from a peer closing every connection at once.") {
+    using namespace std::literals::chrono_literals;
+    const int32_t server{listenOn(43032)};
+    REQUIRE(0 <= server);
+
+    // Accept and close every connection right away.
+    std::atomic<bool> running{true};
+    std::thread t([server, &running]() {
+        struct pollfd fd{};
+        fd.fd = server;
+        fd.events = POLLIN;
+        while (running.load()) {
+            if (0 < ::poll(&fd, 1, 10)) {
+                const int32_t c{::accept(server, nullptr, nullptr)};
+                if (0 <= c) {
+                    ::close(c);
+                }
+            }
+        }
+    });
+
+    uint32_t connections{0};
+    {
+        NCOMTCPReceiver r("127.0.0.1", 43032, nullptr, 200ms);
+        REQUIRE(r.isRunning());
+        std::this_thread::sleep_for(1s);
+        connections = r.connections();
+    }
+    running.store(false);
+    t.join();
+    ::close(server);
+
+    // 100 ms, 200 ms, and then 200 ms between attempts.
+    REQUIRE(1 <= connections);
+    REQUIRE(8 >= connections);
+}
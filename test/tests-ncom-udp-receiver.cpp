@@ -0,0 +1,239 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+
+#include "cluon-complete.hpp"
+
+#include "ncom-udp-receiver.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("Test NCOMUDPReceiver parses unit lists.") {
+    auto units = NCOMUDPReceiver::parseUnits("0.0.0.0:3000:0, 127.0.0.1:3001:7");
+    REQUIRE(2 == units.size());
+    REQUIRE("0.0.0.0" == units[0].address);
+    REQUIRE(3000 == units[0].port);
+    REQUIRE(0 == units[0].senderStamp);
+    REQUIRE("127.0.0.1" == units[1].address);
+    REQUIRE(3001 == units[1].port);
+    REQUIRE(7 == units[1].senderStamp);
+
+    REQUIRE(1 == NCOMUDPReceiver::parseUnits("127.0.0.1:3000:0").size());
+    REQUIRE(NCOMUDPReceiver::parseUnits("127.0.0.1:3000").empty());
+    REQUIRE(NCOMUDPReceiver::parseUnits("127.0.0.1:abc:1").empty());
+}
+
+TEST_CASE("Test NCOMUDPReceiver serves several units from one event loop.") {
+    using namespace std::literals::chrono_literals;
+    auto units = NCOMUDPReceiver::parseUnits("127.0.0.1:43001:1,127.0.0.1:43002:2");
+
+    std::mutex m;
+    std::vector<std::pair<std::size_t, std::string>> received;
+    std::thread::id receivingThread;
+    bool sameThread{true};
+    NCOMUDPReceiver r(units, [&](std::size_t unit, const char *data, std::size_t length, const std::chrono::system_clock::time_point &) {
+        std::lock_guard<std::mutex> lck(m);
+        if (received.empty()) {
+            receivingThread = std::this_thread::get_id();
+        }
+        sameThread &= (receivingThread == std::this_thread::get_id());
+        received.emplace_back(unit, std::string(data, length));
+    });
+    REQUIRE(r.isRunning());
+
+    cluon::UDPSender s1{"127.0.0.1", 43001};
+    cluon::UDPSender s2{"127.0.0.1", 43002};
+    s1.send("Unit one");
+    s2.send("Unit two");
+
+    for (uint32_t i{0}; i < 100; i++) {
+        {
+            std::lock_guard<std::mutex> lck(m);
+            if (2 == received.size()) {
+                break;
+            }
+        }
+        std::this_thread::sleep_for(10ms);
+    }
+
+    std::lock_guard<std::mutex> lck(m);
+    REQUIRE(2 == received.size());
+    REQUIRE(sameThread);
+    for (auto &e : received) {
+        const bool MATCHES{((0 == e.first) && ("Unit one" == e.second)) || ((1 == e.first) && ("Unit two" == e.second))};
+        REQUIRE(MATCHES);
+    }
+}
+
+TEST_CASE("Test NCOMUDPReceiver parses source-specific multicast units.") {
+    auto units = NCOMUDPReceiver::parseUnits("239.1.2.3@195.0.0.33:3000:4");
+    REQUIRE(1 == units.size());
+    REQUIRE("239.1.2.3" == units[0].address);
+    REQUIRE("195.0.0.33" == units[0].source);
+    REQUIRE(3000 == units[0].port);
+    REQUIRE(4 == units[0].senderStamp);
+
+    // Only multicast groups can be restricted to a sender.
+    REQUIRE(NCOMUDPReceiver::parseUnits("127.0.0.1@195.0.0.33:3000:4").empty());
+    REQUIRE(NCOMUDPReceiver::parseUnits("0.0.0.0@195.0.0.33:3000:4").empty());
+    NCOMUDPReceiver::Unit unicast;
+    unicast.address = "127.0.0.1";
+    unicast.source = "195.0.0.33";
+    unicast.port = 43009;
+    REQUIRE(!NCOMUDPReceiver(std::vector<NCOMUDPReceiver::Unit>{unicast}, nullptr).isValid());
+}
+
+TEST_CASE("Test NCOMUDPReceiver filters multicast senders by source on loopback.") {
+    using namespace std::literals::chrono_literals;
+    auto fromLoopback = NCOMUDPReceiver::parseUnits("239.255.42.99@127.0.0.1:43003:1");
+    auto fromElsewhere = NCOMUDPReceiver::parseUnits("239.255.42.99@10.255.255.1:43003:2");
+    fromLoopback[0].interfaceAddress = "127.0.0.1";
+    fromElsewhere[0].interfaceAddress = "127.0.0.1";
+
+    std::atomic<uint32_t> receivedFromLoopback{0};
+    std::atomic<uint32_t> receivedFromElsewhere{0};
+    REQUIRE(1 == fromLoopback.size());
+    REQUIRE(1 == fromElsewhere.size());
+    NCOMUDPReceiver r1(fromLoopback, [&](std::size_t, const char *, std::size_t, const std::chrono::system_clock::time_point &) { receivedFromLoopback++; });
+    NCOMUDPReceiver r2(fromElsewhere, [&](std::size_t, const char *, std::size_t, const std::chrono::system_clock::time_point &) { receivedFromElsewhere++; });
+    REQUIRE(r1.isRunning());
+    REQUIRE(r2.isRunning());
+
+    // Send to the group via the loopback interface.
+    int s = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    REQUIRE(0 <= s);
+    struct in_addr loopback{};
+    ::inet_pton(AF_INET, "127.0.0.1", &loopback);
+    ::setsockopt(s, IPPROTO_IP, IP_MULTICAST_IF, &loopback, sizeof(loopback));
+    const unsigned char YES{1};
+    ::setsockopt(s, IPPROTO_IP, IP_MULTICAST_LOOP, &YES, sizeof(YES));
+    struct sockaddr_in group{};
+    group.sin_family = AF_INET;
+    group.sin_port = htons(43003);
+    ::inet_pton(AF_INET, "239.255.42.99", &group.sin_addr);
+    const std::string DATA{"NCOM"};
+    REQUIRE(static_cast<ssize_t>(DATA.size()) == ::sendto(s, DATA.data(), DATA.size(), 0, reinterpret_cast<struct sockaddr *>(&group), sizeof(group)));
+    ::close(s);
+
+    for (uint32_t i{0}; (i < 100) && (0 == receivedFromLoopback.load()); i++) {
+        std::this_thread::sleep_for(10ms);
+    }
+    std::this_thread::sleep_for(50ms);
+
+    REQUIRE(1 == receivedFromLoopback.load());
+    REQUIRE(0 == receivedFromElsewhere.load());
+}
+
+TEST_CASE("Test NCOMUDPReceiver with io_uring backend.") {
+    using namespace std::literals::chrono_literals;
+    auto units = NCOMUDPReceiver::parseUnits("127.0.0.1:43004:1,127.0.0.1:43005:2");
+
+    std::mutex m;
+    std::vector<std::pair<std::size_t, std::string>> received;
+    NCOMUDPReceiver r(units, [&](std::size_t unit, const char *data, std::size_t length, const std::chrono::system_clock::time_point &) {
+        std::lock_guard<std::mutex> lck(m);
+        received.emplace_back(unit, std::string(data, length));
+    }, NCOMUDPReceiver::Backend::IO_URING);
+    REQUIRE(r.isRunning());
+
+    // Give the receiving thread time to arm its requests or to fall back.
+    std::this_thread::sleep_for(50ms);
+    if (NCOMUDPReceiver::Backend::IO_URING != r.backend()) {
+        WARN("Skipping: io_uring is not supported here; the receiver fell back to epoll.");
+        return;
+    }
+
+    cluon::UDPSender s1{"127.0.0.1", 43004};
+    cluon::UDPSender s2{"127.0.0.1", 43005};
+    constexpr uint32_t PACKETS{300};
+    for (uint32_t i{0}; i < PACKETS; i++) {
+        s1.send(std::to_string(i));
+        s2.send(std::to_string(i));
+        if (0 == (i % 50)) {
+            std::this_thread::sleep_for(1ms);
+        }
+    }
+
+    for (uint32_t i{0}; i < 200; i++) {
+        {
+            std::lock_guard<std::mutex> lck(m);
+            if (2 * PACKETS == received.size()) {
+                break;
+            }
+        }
+        std::this_thread::sleep_for(10ms);
+    }
+
+    std::lock_guard<std::mutex> lck(m);
+    REQUIRE(2 * PACKETS == received.size());
+    uint32_t next[2]{0, 0};
+    bool ordered{true};
+    for (auto &e : received) {
+        ordered &= (std::to_string(next[e.first]++) == e.second);
+    }
+    REQUIRE(ordered);
+}
+
+TEST_CASE("Test NCOMUDPReceiver reports datagrams dropped by the kernel.") {
+    using namespace std::literals::chrono_literals;
+    auto units = NCOMUDPReceiver::parseUnits("127.0.0.1:43021:1");
+
+    std::atomic<uint32_t> received{0};
+    std::atomic<bool> stall{true};
+    NCOMUDPReceiver r(units, [&](std::size_t, const char *, std::size_t, const std::chrono::system_clock::time_point &) {
+        // Stall on the first datagram so that the socket's buffer overflows.
+        while (stall.load()) {
+            std::this_thread::sleep_for(1ms);
+        }
+        received++;
+    });
+    REQUIRE(r.isRunning());
+    REQUIRE(0 < r.statistics(0).receiveBuffer);
+
+    constexpr uint32_t SENT{20000};
+    const std::string DATAGRAM(72, 'x');
+    cluon::UDPSender s{"127.0.0.1", 43021};
+    for (uint32_t i{0}; i < SENT; i++) {
+        s.send(std::string(DATAGRAM));
+    }
+    stall.store(false);
+
+    // The drop counter is reported with the next datagram queued after an overflow.
+    for (uint32_t i{0}; (i < 100) && (received.load() + r.statistics(0).drops < SENT); i++) {
+        std::this_thread::sleep_for(10ms);
+    }
+    s.send(std::string(DATAGRAM));
+    for (uint32_t i{0}; (i < 100) && (received.load() + r.statistics(0).drops < SENT + 1); i++) {
+        std::this_thread::sleep_for(10ms);
+    }
+
+    const NCOMUDPReceiver::Statistics STATISTICS{r.statistics(0)};
+    REQUIRE(0 < STATISTICS.drops);
+    REQUIRE(SENT + 1 == received.load() + STATISTICS.drops);
+    REQUIRE(received.load() == STATISTICS.datagrams);
+}
@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+
+#include "shared-nav-state-history.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+
+namespace {
+// Record every 10 ms, received 2 ms later.
+NavStateRecord sample(uint32_t senderStamp, int64_t i) {
+    NavStateRecord r;
+    r.senderStamp = senderStamp;
+    r.sampleTime = 1000000 + i * 10000;
+    r.received = r.sampleTime + 2000;
+    r.latitude = 57.0 + static_cast<double>(i) * 0.001;
+    r.altitude = static_cast<float>(i);
+    r.heading = 0.1f * static_cast<float>(i);
+    return r;
+}
+}
+
+TEST_CASE("Test SharedNavStateHistory rejects invalid parameters and missing segments.") {
+    REQUIRE(!SharedNavStateHistory("opendlv-device-gps-ncom-test-history-missing").isValid());
+    REQUIRE(!SharedNavStateHistory("opendlv-device-gps-ncom-test-history-invalid", 100, 0).isValid());
+    REQUIRE(!SharedNavStateHistory("opendlv-device-gps-ncom-test-history-invalid", 100, SharedNavStateHistory::MAX_UNITS + 1).isValid());
+}
+
+TEST_CASE("Test SharedNavStateHistory finds and interpolates records by either time.") {
+    SharedNavStateHistory writer{"opendlv-device-gps-ncom-test-history", 100, 2};
+    REQUIRE(writer.isValid());
+    REQUIRE(128 == writer.capacity());
+    SharedNavStateHistory reader{"opendlv-device-gps-ncom-test-history"};
+    REQUIRE(reader.isValid());
+    REQUIRE(128 == reader.capacity());
+
+    NavStateRecord record;
+    REQUIRE(!reader.at(1, 1000000, SharedNavStateHistory::TimeBase::SAMPLE_TIME, record));
+    for (int64_t i{0}; i < 10; i++) {
+        writer.write(sample(1, i));
+    }
+
+    int64_t oldest{0};
+    int64_t newest{0};
+    REQUIRE(reader.span(1, SharedNavStateHistory::TimeBase::SAMPLE_TIME, oldest, newest));
+    REQUIRE(1000000 == oldest);
+    REQUIRE(1090000 == newest);
+    REQUIRE(!reader.span(2, SharedNavStateHistory::TimeBase::SAMPLE_TIME, oldest, newest));
+
+    // Exactly on a record, including the oldest and the newest.
+    for (int64_t i : {0, 3, 9}) {
+        REQUIRE(reader.at(1, 1000000 + i * 10000, SharedNavStateHistory::TimeBase::SAMPLE_TIME, record));
+        REQUIRE(1000000 + i * 10000 == record.sampleTime);
+        REQUIRE(static_cast<float>(i) == Approx(record.altitude));
+    }
+
+    // Between two records.
+    REQUIRE(reader.at(1, 1032500, SharedNavStateHistory::TimeBase::SAMPLE_TIME, record));
+    REQUIRE(1 == record.senderStamp);
+    REQUIRE(1032500 == record.sampleTime);
+    REQUIRE(1034500 == record.received);
+    REQUIRE(57.00325 == Approx(record.latitude));
+    REQUIRE(3.25f == Approx(record.altitude));
+    REQUIRE(0.325f == Approx(record.heading));
+
+    // The same instant by host time.
+    REQUIRE(reader.at(1, 1034500, SharedNavStateHistory::TimeBase::RECEIVED, record));
+    REQUIRE(1032500 == record.sampleTime);
+    REQUIRE(3.25f == Approx(record.altitude));
+
+    // Outside of the records.
+    REQUIRE(!reader.at(1, 999999, SharedNavStateHistory::TimeBase::SAMPLE_TIME, record));
+    REQUIRE(!reader.at(1, 1090001, SharedNavStateHistory::TimeBase::SAMPLE_TIME, record));
+    REQUIRE(!reader.at(1, 1001000, SharedNavStateHistory::TimeBase::RECEIVED, record));
+    REQUIRE(!reader.at(2, 1032500, SharedNavStateHistory::TimeBase::SAMPLE_TIME, record));
+}
+
+TEST_CASE("Test SharedNavStateHistory keeps the most recent records per unit.") {
+    SharedNavStateHistory writer{"opendlv-device-gps-ncom-test-history-wrap", 16, 2};
+    REQUIRE(writer.isValid());
+    SharedNavStateHistory reader{"opendlv-device-gps-ncom-test-history-wrap"};
+    REQUIRE(reader.isValid());
+
+    for (int64_t i{0}; i < 100; i++) {
+        writer.write(sample(1, i));
+        writer.write(sample(2, 2 * i));
+    }
+    // A third unit does not fit.
+    writer.write(sample(3, 0));
+
+    int64_t oldest{0};
+    int64_t newest{0};
+    REQUIRE(reader.span(1, SharedNavStateHistory::TimeBase::SAMPLE_TIME, oldest, newest));
+    REQUIRE(1000000 + 84 * 10000 == oldest);
+    REQUIRE(1000000 + 99 * 10000 == newest);
+    REQUIRE(reader.span(2, SharedNavStateHistory::TimeBase::SAMPLE_TIME, oldest, newest));
+    REQUIRE(1000000 + 168 * 10000 == oldest);
+    REQUIRE(1000000 + 198 * 10000 == newest);
+    REQUIRE(!reader.span(3, SharedNavStateHistory::TimeBase::SAMPLE_TIME, oldest, newest));
+
+    NavStateRecord record;
+    REQUIRE(!reader.at(1, 1000000 + 83 * 10000, SharedNavStateHistory::TimeBase::SAMPLE_TIME, record));
+    REQUIRE(reader.at(1, 1000000 + 84 * 10000, SharedNavStateHistory::TimeBase::SAMPLE_TIME, record));
+    REQUIRE(84.0f == Approx(record.altitude));
+    REQUIRE(reader.at(2, 1000000 + 171 * 10000, SharedNavStateHistory::TimeBase::SAMPLE_TIME, record));
+    REQUIRE(171.0f == Approx(record.altitude));
+}
+
+TEST_CASE("Test SharedNavStateHistory interpolates angles along the shorter arc.") {
+    SharedNavStateHistory writer{"opendlv-device-gps-ncom-test-history-angle", 4, 1};
+    REQUIRE(writer.isValid());
+    NavStateRecord a{sample(0, 0)};
+    a.heading = static_cast<float>(M_PI) - 0.1f;
+    a.roll = -0.2f;
+    NavStateRecord b{sample(0, 1)};
+    b.heading = -static_cast<float>(M_PI) + 0.1f;
+    b.roll = 0.2f;
+    writer.write(a);
+    writer.write(b);
+
+    SharedNavStateHistory reader{"opendlv-device-gps-ncom-test-history-angle"};
+    NavStateRecord record;
+    REQUIRE(reader.at(0, 1002500, SharedNavStateHistory::TimeBase::SAMPLE_TIME, record));
+    REQUIRE(static_cast<float>(M_PI) - 0.05f == Approx(record.heading));
+    REQUIRE(-0.1f == Approx(record.roll));
+    REQUIRE(reader.at(0, 1007500, SharedNavStateHistory::TimeBase::SAMPLE_TIME, record));
+    REQUIRE(-static_cast<float>(M_PI) + 0.05f == Approx(record.heading));
+}
+
+TEST_CASE("Test SharedNavStateHistory readers never see overwritten records.") {
+    SharedNavStateHistory writer{"opendlv-device-gps-ncom-test-history-torn", 64, 1};
+    REQUIRE(writer.isValid());
+    SharedNavStateHistory reader{"opendlv-device-gps-ncom-test-history-torn"};
+    REQUIRE(reader.isValid());
+
+    std::atomic<int64_t> written{0};
+    std::atomic<bool> running{true};
+    std::thread t([&writer, &written, &running]() {
+        for (int64_t i{0}; running.load(); i++) {
+            writer.write(sample(0, i));
+            written.store(i + 1);
+        }
+    });
+
+    uint32_t found{0};
+    uint32_t wrong{0};
+    // Look up recent instants until enough were found while the writer is running.
+    const auto DEADLINE{std::chrono::steady_clock::now() + std::chrono::seconds(5)};
+    while ( (10000 > found) && (std::chrono::steady_clock::now() < DEADLINE) ) {
+        const int64_t I{written.load() - 3};
+        if (0 > I) {
+            continue;
+        }
+        NavStateRecord r;
+        const int64_t TIME{1000000 + I * 10000 + 5000};
+        if (reader.at(0, TIME, SharedNavStateHistory::TimeBase::SAMPLE_TIME, r)) {
+            const bool SAME{(TIME == r.sampleTime) && (std::fabs(57.0 + (static_cast<double>(I) + 0.5) * 0.001 - r.latitude) < 1e-7)};
+            found += SAME ? 1 : 0;
+            wrong += SAME ? 0 : 1;
+        }
+    }
+    running.store(false);
+    t.join();
+
+    REQUIRE(10000 == found);
+    REQUIRE(0 == wrong);
+}
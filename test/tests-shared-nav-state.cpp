@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+
+#include "shared-nav-state.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+TEST_CASE("Test SharedNavState readers need an existing segment.") {
+    SharedNavState reader{"opendlv-device-gps-ncom-test-missing"};
+    REQUIRE(!reader.isValid());
+    NavStateRecord record;
+    REQUIRE(!reader.read(0, record));
+}
+
+TEST_CASE("Test SharedNavState provides the latest record per unit.") {
+    SharedNavState writer{"opendlv-device-gps-ncom-test-latest", true};
+    REQUIRE(writer.isValid());
+    SharedNavState reader{"opendlv-device-gps-ncom-test-latest"};
+    REQUIRE(reader.isValid());
+
+    NavStateRecord record;
+    REQUIRE(!reader.read(1, record));
+
+    for (uint32_t i{0}; i < 3; i++) {
+        NavStateRecord r;
+        r.senderStamp = 1;
+        r.sampleTime = 1000 + i;
+        r.latitude = 57.0 + i;
+        writer.write(r);
+    }
+    NavStateRecord other;
+    other.senderStamp = 2;
+    other.sampleTime = 5;
+    writer.write(other);
+
+    REQUIRE(reader.read(1, record));
+    REQUIRE(1 == record.senderStamp);
+    REQUIRE(1002 == record.sampleTime);
+    REQUIRE(59.0 == Approx(record.latitude));
+    REQUIRE(reader.read(2, record));
+    REQUIRE(5 == record.sampleTime);
+    REQUIRE(!reader.read(3, record));
+
+    // Only the writer writes.
+    reader.write(other);
+    REQUIRE(reader.read(1, record));
+    REQUIRE(1002 == record.sampleTime);
+}
+
+TEST_CASE("Test SharedNavState readers never see torn records.") {
+    SharedNavState writer{"opendlv-device-gps-ncom-test-torn", true};
+    REQUIRE(writer.isValid());
+    SharedNavState reader{"opendlv-device-gps-ncom-test-torn"};
+    REQUIRE(reader.isValid());
+
+    std::atomic<bool> running{true};
+    std::thread t([&writer, &running]() {
+        for (int64_t i{1}; running.load(); i++) {
+            NavStateRecord r;
+            r.sampleTime = i;
+            r.received = i;
+            r.latitude = static_cast<double>(i);
+            r.angularVelocityZ = static_cast<float>(i % 1000);
+            writer.write(r);
+        }
+    });
+
+    uint32_t consistent{0};
+    uint32_t torn{0};
+    int64_t last{0};
+    bool monotonic{true};
+    // Until enough records were read while the writer is running.
+    const auto DEADLINE{std::chrono::steady_clock::now() + std::chrono::seconds(5)};
+    while ( (100000 > consistent + torn) && (std::chrono::steady_clock::now() < DEADLINE) ) {
+        NavStateRecord r;
+        if (reader.read(0, r)) {
+            const bool SAME{(r.sampleTime == r.received) && (static_cast<double>(r.sampleTime) == Approx(r.latitude))
+                            && (static_cast<float>(r.sampleTime % 1000) == Approx(r.angularVelocityZ))};
+            consistent += SAME ? 1 : 0;
+            torn += SAME ? 0 : 1;
+            monotonic = monotonic && (last <= r.sampleTime);
+            last = r.sampleTime;
+        }
+    }
+    running.store(false);
+    t.join();
+
+    REQUIRE(100000 == consistent);
+    REQUIRE(0 == torn);
+    REQUIRE(monotonic);
+}
@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+
+#include "spsc-ring.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+TEST_CASE("Test SPSCRing rounds capacity up and keeps FIFO order.") {
+    SPSCRing<uint32_t> r(3, OverflowPolicy::DROP_NEWEST);
+    REQUIRE(4 == r.capacity());
+    REQUIRE(r.empty());
+
+    REQUIRE(r.push(1));
+    REQUIRE(r.push(2));
+    REQUIRE(2 == r.size());
+
+    uint32_t v{0};
+    REQUIRE(r.pop(v));
+    REQUIRE(1 == v);
+    REQUIRE(r.pop(v));
+    REQUIRE(2 == v);
+    REQUIRE(!r.pop(v));
+}
+
+TEST_CASE("Test SPSCRing drops newest entries when full.") {
+    SPSCRing<uint32_t> r(2, OverflowPolicy::DROP_NEWEST);
+    REQUIRE(r.push(1));
+    REQUIRE(r.push(2));
+    REQUIRE(!r.push(3));
+    REQUIRE(1 == r.dropped());
+
+    uint32_t v{0};
+    REQUIRE(r.pop(v));
+    REQUIRE(1 == v);
+    REQUIRE(r.pop(v));
+    REQUIRE(2 == v);
+}
+
+TEST_CASE("Test SPSCRing drops oldest entries when full.") {
+    SPSCRing<uint32_t> r(2, OverflowPolicy::DROP_OLDEST);
+    REQUIRE(r.push(1));
+    REQUIRE(r.push(2));
+    REQUIRE(r.push(3));
+    REQUIRE(r.push(4));
+    REQUIRE(2 == r.dropped());
+    REQUIRE(2 == r.size());
+
+    uint32_t v{0};
+    REQUIRE(r.pop(v));
+    REQUIRE(3 == v);
+    REQUIRE(r.pop(v));
+    REQUIRE(4 == v);
+}
+
+TEST_CASE("Test SPSCRing waitAndPop times out and wakes up.") {
+    using namespace std::literals::chrono_literals;
+    SPSCRing<uint32_t> r(4, OverflowPolicy::DROP_OLDEST);
+    uint32_t v{0};
+    REQUIRE(!r.waitAndPop(v, 1ms));
+
+    std::thread producer([&r]() {
+        std::this_thread::sleep_for(10ms);
+        r.push(42);
+    });
+    REQUIRE(r.waitAndPop(v, 5s));
+    REQUIRE(42 == v);
+    producer.join();
+}
+
+TEST_CASE("Test SPSCRing delivers in order across threads.") {
+    using namespace std::literals::chrono_literals;
+    constexpr uint32_t ENTRIES{100000};
+    SPSCRing<uint32_t> r(64, OverflowPolicy::DROP_OLDEST);
+
+    std::thread producer([&r]() {
+        for (uint32_t i{1}; i <= ENTRIES; i++) {
+            r.push(i);
+        }
+    });
+
+    uint32_t last{0};
+    uint32_t received{0};
+    bool ordered{true};
+    while (last < ENTRIES) {
+        uint32_t v{0};
+        if (r.waitAndPop(v, 100ms)) {
+            ordered &= (v > last);
+            last = v;
+            received++;
+        }
+    }
+    producer.join();
+
+    REQUIRE(ordered);
+    REQUIRE(ENTRIES == received + r.dropped());
+}
+
+TEST_CASE("Test SPSCRing keeps only the latest entry.") {
+    SPSCRing<uint32_t> r(4, OverflowPolicy::KEEP_LATEST);
+    REQUIRE(r.push(1));
+    REQUIRE(r.push(2));
+    REQUIRE(r.push(3));
+    REQUIRE(2 == r.dropped());
+    REQUIRE(1 == r.size());
+    REQUIRE(1 == r.highWaterMark());
+
+    uint32_t v{0};
+    REQUIRE(r.pop(v));
+    REQUIRE(3 == v);
+    REQUIRE(!r.pop(v));
+}
+
+TEST_CASE("Test SPSCRing blocks the producer when full and never drops.") {
+    using namespace std::literals::chrono_literals;
+    constexpr uint32_t ENTRIES{100000};
+    SPSCRing<uint32_t> r(16, OverflowPolicy::BLOCK);
+
+    std::thread producer([&r]() {
+        for (uint32_t i{1}; i <= ENTRIES; i++) {
+            r.push(i);
+        }
+    });
+
+    // Let the producer fill the ring and wait.
+    std::this_thread::sleep_for(50ms);
+    REQUIRE(16 == r.size());
+
+    uint32_t expected{1};
+    bool ordered{true};
+    while (expected <= ENTRIES) {
+        uint32_t v{0};
+        if (r.waitAndPop(v, 100ms)) {
+            ordered &= (v == expected);
+            expected++;
+        }
+    }
+    producer.join();
+
+    REQUIRE(ordered);
+    REQUIRE(0 == r.dropped());
+    REQUIRE(0 < r.blocked());
+    REQUIRE(16 == r.highWaterMark());
+}
+
+TEST_CASE("Test SPSCRing never hands out entries overwritten while they were copied.") {
+    using namespace std::literals::chrono_literals;
+    // Large entries take long to copy; a torn copy mixes two values.
+    using Entry = std::array<uint64_t, 128>;
+    for (auto policy : {OverflowPolicy::DROP_OLDEST, OverflowPolicy::KEEP_LATEST}) {
+        SPSCRing<Entry> r(2, policy);
+        std::atomic<bool> running{true};
+        std::thread producer([&r, &running]() {
+            Entry e;
+            for (uint64_t i{0}; running.load(); i++) {
+                e.fill(i);
+                r.push(e);
+                // Leave the consumer a chance to take an entry before the next push drops it.
+                std::this_thread::yield();
+            }
+        });
+
+        uint32_t taken{0};
+        uint32_t torn{0};
+        const auto DEADLINE{std::chrono::steady_clock::now() + 5s};
+        while ( (10000 > taken) && (std::chrono::steady_clock::now() < DEADLINE) ) {
+            Entry e;
+            if (r.pop(e)) {
+                taken++;
+                for (auto v : e) {
+                    torn += (v != e[0]) ? 1 : 0;
+                }
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        running.store(false);
+        producer.join();
+
+        REQUIRE(10000 == taken);
+        REQUIRE(0 == torn);
+    }
+}
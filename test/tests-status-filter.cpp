@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+
+#include "cluon-complete.hpp"
+
+#include "status-filter.hpp"
+
+#include <cstdint>
+
+TEST_CASE("Test StatusFilter publishes on changes beyond deadbands and on heartbeat.") {
+    StatusFilter::Deadbands deadbands;
+    deadbands.position = 0.05f;
+    StatusFilter f{deadbands, 1000000};
+
+    opendlv::device::gps::ncom::Status status;
+    status.navigationStatus(4).satellites(10).northAccuracy(0.5f);
+    REQUIRE(f.pass(status, 0));
+    REQUIRE(!f.pass(status, 100000));
+
+    // Within the deadband, also when accumulated slowly.
+    status.northAccuracy(0.53f);
+    REQUIRE(!f.pass(status, 200000));
+    status.northAccuracy(0.54f);
+    REQUIRE(!f.pass(status, 300000));
+    status.northAccuracy(0.56f);
+    REQUIRE(f.pass(status, 400000));
+
+    // Discrete fields always count.
+    status.satellites(11);
+    REQUIRE(f.pass(status, 500000));
+    REQUIRE(!f.pass(status, 600000));
+
+    // Heartbeat and time going backwards (e.g., replay).
+    REQUIRE(f.pass(status, 1500000));
+    REQUIRE(!f.pass(status, 1600000));
+    REQUIRE(f.pass(status, 0));
+}
+
+TEST_CASE("Test StatusFilter parses deadbands.") {
+    StatusFilter::Deadbands d;
+    REQUIRE(StatusFilter::parseDeadbands("", d));
+    REQUIRE(0.01f == Approx(d.position));
+    REQUIRE(StatusFilter::parseDeadbands("velocity:0.2, orientation:0.01", d));
+    REQUIRE(0.01f == Approx(d.position));
+    REQUIRE(0.2f == Approx(d.velocity));
+    REQUIRE(0.01f == Approx(d.orientation));
+    REQUIRE(!StatusFilter::parseDeadbands("speed:1", d));
+    REQUIRE(!StatusFilter::parseDeadbands("position", d));
+    REQUIRE(!StatusFilter::parseDeadbands("position:x", d));
+    REQUIRE(!StatusFilter::parseDeadbands("position:1,,velocity:1", d));
+}